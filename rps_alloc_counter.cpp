@@ -0,0 +1,32 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+// Replacement global allocation functions that count every heap
+// allocation into the calling thread's heapAllocationCount. Only built with
+// -DRPS_COUNT_ALLOCATIONS=ON, where RPSSimulator::update() uses the count
+// to check that warmed-up generations do not allocate.
+
+#include "rps_simulator.h"
+
+#include <new>
+
+void* operator new(std::size_t size) {
+    heapAllocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+    heapAllocationCount++;
+    size_t alignment = static_cast<size_t>(align);
+    if (void* p = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
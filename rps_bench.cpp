@@ -0,0 +1,377 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#include "rps_simulator.h"
+#include "rps_quantized.h"
+#ifdef RPS_ENABLE_SESSIONS
+#include "rps_sessions.h"
+#endif
+
+#include <benchmark/benchmark.h>
+
+// Benchmarks for the simulator hot paths. Every fixture is seeded so runs
+// are comparable across commits:
+//   ./rps_bench --benchmark_filter=Update
+
+namespace {
+
+constexpr uint64_t benchSeed = 2025;
+
+// Fill a store with n agents in a width x height box, types interleaved
+void fillAgents(AgentStore& agents, size_t n, float width, float height) {
+    CounterRng rng(benchSeed);
+    agents.clear();
+    agents.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        agents.add(static_cast<ObjectType>(i % 3),
+                   rng.uniform(i, 0, 10, width - 10), rng.uniform(i, 1, 10, height - 10),
+                   rng.uniform(i, 2, -2.0f, 2.0f), rng.uniform(i, 3, -2.0f, 2.0f));
+    }
+}
+
+// Side of a square box giving each of n agents areaPerAgent square units
+float boxSide(size_t n, double areaPerAgent) {
+    return std::max(30.0f, static_cast<float>(std::sqrt(n * areaPerAgent)));
+}
+
+SimulationParams paramsFor(size_t n, float side) {
+    SimulationParams params;
+    params.boxWidth = side;
+    params.boxHeight = side;
+    params.rocks = static_cast<int>(n / 3 + (n % 3 > 0));
+    params.papers = static_cast<int>(n / 3 + (n % 3 > 1));
+    params.scissors = static_cast<int>(n / 3);
+    return params;
+}
+
+// The original all-pairs step, kept as the baseline the grid is measured against
+void bruteForceStep(AgentStore& agents, float width, float height) {
+    size_t n = agents.size();
+    for (size_t i = 0; i < n; i++) {
+        GameObject obj = agents[i];
+        obj.update();
+        obj.handleBoundaries(width, height);
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            GameObject obj1 = agents[i];
+            GameObject obj2 = agents[j];
+            if (obj1.collidesWith(obj2)) GameRules::resolveCollision(obj1, obj2);
+        }
+    }
+}
+
+void BM_GameObjectUpdate(benchmark::State& state) {
+    AgentStore agents;
+    fillAgents(agents, static_cast<size_t>(state.range(0)), 1000, 1000);
+    for (auto _ : state) {
+        for (size_t i = 0; i < agents.size(); i++) agents[i].update();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GameObjectUpdate)->Arg(15)->Arg(1 << 10)->Arg(1 << 16);
+
+void BM_HandleBoundaries(benchmark::State& state) {
+    AgentStore agents;
+    fillAgents(agents, static_cast<size_t>(state.range(0)), 1000, 1000);
+    for (auto _ : state) {
+        for (size_t i = 0; i < agents.size(); i++) agents[i].handleBoundaries(1000, 1000);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HandleBoundaries)->Arg(15)->Arg(1 << 10)->Arg(1 << 16);
+
+void BM_CollidesWith(benchmark::State& state) {
+    AgentStore agents;
+    fillAgents(agents, 1024, 300, 300);
+    size_t pairs = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i + 1 < agents.size(); i += 2) {
+            benchmark::DoNotOptimize(agents[i].collidesWith(agents[i + 1]));
+        }
+        pairs += agents.size() / 2;
+    }
+    state.SetItemsProcessed(pairs);
+}
+BENCHMARK(BM_CollidesWith);
+
+void BM_DetermineWinner(benchmark::State& state) {
+    for (auto _ : state) {
+        for (int a = 0; a < 3; a++) {
+            for (int b = 0; b < 3; b++) {
+                benchmark::DoNotOptimize(GameRules::determineWinner(static_cast<ObjectType>(a),
+                                                                    static_cast<ObjectType>(b)));
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * 9);
+}
+BENCHMARK(BM_DetermineWinner);
+
+// Resolve a fixed overlapping pair, restoring it each time so every
+// iteration does the same conversion and push-apart
+void BM_ResolveCollision(benchmark::State& state) {
+    AgentStore agents;
+    agents.add(ObjectType::ROCK, 50, 50, 1, 0);
+    agents.add(ObjectType::SCISSORS, 55, 50, -1, 0);
+    for (auto _ : state) {
+        agents.x[0] = 50;
+        agents.x[1] = 55;
+        agents.type[1] = static_cast<uint8_t>(ObjectType::SCISSORS);
+        GameObject obj1 = agents[0];
+        GameObject obj2 = agents[1];
+        GameRules::resolveCollision(obj1, obj2);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ResolveCollision);
+
+// Full generation. Args are {agents, area per agent}; 100 is crowded,
+// 2500 is sparse. The simulator is rebuilt when the game ends so the
+// population stays mixed.
+void BM_SimulatorUpdate(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    float side = boxSide(n, static_cast<double>(state.range(1)));
+    SimulationParams params = paramsFor(n, side);
+    auto simulator = std::make_unique<RPSSimulator>(params, benchSeed);
+    for (auto _ : state) {
+        if (simulator->isGameOver()) {
+            state.PauseTiming();
+            simulator = std::make_unique<RPSSimulator>(params, benchSeed);
+            state.ResumeTiming();
+        }
+        simulator->update();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["box"] = side;
+}
+BENCHMARK(BM_SimulatorUpdate)
+    ->ArgsProduct({{15, 1 << 10, 1 << 14, 1 << 17, 1 << 20}, {100, 667, 2500}})
+    ->Unit(benchmark::kMicrosecond);
+
+// The fixed-point engine on the same worlds as BM_SimulatorUpdate at the
+// default density; "bytes" is its agent state per agent
+void BM_QuantizedUpdate(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    auto simulator = std::make_unique<QuantizedRPSSimulator>(params, benchSeed);
+    for (auto _ : state) {
+        if (simulator->isGameOver()) {
+            state.PauseTiming();
+            simulator = std::make_unique<QuantizedRPSSimulator>(params, benchSeed);
+            state.ResumeTiming();
+        }
+        simulator->update();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes"] = static_cast<double>(simulator->stateBytes()) / static_cast<double>(n);
+}
+BENCHMARK(BM_QuantizedUpdate)->Arg(1 << 14)->Arg(1 << 17)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+
+// Eight small ensemble worlds stepped one after another (0) or together in
+// a WorldBatch (1), with finished worlds restarted on the next seed
+void BM_WorldBatchUpdate(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    bool batched = state.range(1) != 0;
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    params.threads = 1;
+    uint64_t nextSeed = benchSeed;
+    WorldBatch batch(params);
+    std::vector<std::unique_ptr<RPSSimulator>> simulators(WorldBatch::width);
+    for (size_t lane = 0; lane < WorldBatch::width; lane++) {
+        if (batched) batch.load(lane, nextSeed++);
+        else simulators[lane] = std::make_unique<RPSSimulator>(params, nextSeed++);
+    }
+    for (auto _ : state) {
+        if (batched) {
+            batch.update();
+        } else {
+            for (auto& simulator : simulators) simulator->update();
+        }
+        state.PauseTiming();
+        for (size_t lane = 0; lane < WorldBatch::width; lane++) {
+            if (batched && batch.world(lane).isDecided()) batch.load(lane, nextSeed++);
+            if (!batched && simulators[lane]->isDecided())
+                simulators[lane] = std::make_unique<RPSSimulator>(params, nextSeed++);
+        }
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * WorldBatch::width);
+}
+BENCHMARK(BM_WorldBatchUpdate)->ArgsProduct({{15, 60, 240}, {0, 1}});
+
+#ifdef RPS_ENABLE_SESSIONS
+// Scheduler overhead: range(0) 15-agent sessions on one worker, each frame
+// a single generation, paced so fast that every frame is already due.
+// Items are agent updates, as in BM_SimulatorUpdate/15/667.
+void BM_SessionScheduler(benchmark::State& state) {
+    size_t sessions = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(15, boxSide(15, 667));
+    SessionPacing pacing;
+    pacing.fps = 1e9;
+    pacing.maxGenerations = 100;
+    uint64_t frames = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<std::unique_ptr<RPSSimulator>> simulators;
+        for (size_t i = 0; i < sessions; i++) simulators.emplace_back(new RPSSimulator(params, benchSeed + i));
+        state.ResumeTiming();
+        SessionScheduler scheduler(1);
+        for (auto& simulator : simulators) {
+            scheduler.spawn(liveSession(scheduler, *simulator, pacing, [&frames](const RPSSimulator&, const FrameTiming&) {
+                frames++;
+                return true;
+            }));
+        }
+        scheduler.wait();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(frames * 15));
+}
+BENCHMARK(BM_SessionScheduler)->Arg(16)->Arg(1 << 10)->Arg(1 << 14)->UseRealTime()->Unit(benchmark::kMillisecond);
+#endif
+
+void BM_SimulatorUpdateThreads(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 2500));
+    auto simulator = std::make_unique<RPSSimulator>(params, benchSeed);
+    simulator->setThreadCount(static_cast<unsigned>(state.range(1)));
+    for (auto _ : state) simulator->update();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["threads"] = simulator->getThreadCount();
+}
+BENCHMARK(BM_SimulatorUpdateThreads)
+    ->ArgsProduct({{1 << 14, 1 << 17}, {1, 0}})
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+// Swept collisions. Args are {agents, timestep}; one iteration at timestep
+// 4 covers the simulated time of four discrete generations.
+void BM_SimulatorUpdateSwept(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    params.timestep = static_cast<float>(state.range(1));
+    params.sweptCollisions = true;
+    RPSSimulator simulator(params, benchSeed);
+    for (auto _ : state) simulator.update();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimulatorUpdateSwept)->ArgsProduct({{1 << 10, 1 << 14}, {1, 4}})->Unit(benchmark::kMicrosecond);
+
+// Building a world from scratch. Args are {agents, threads}; 0 threads is
+// one per core.
+void BM_InitializePopulation(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    params.threads = static_cast<unsigned>(state.range(1));
+    for (auto _ : state) {
+        RPSSimulator simulator(params, benchSeed);
+        benchmark::DoNotOptimize(simulator.getAgents().x.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InitializePopulation)
+    ->ArgsProduct({{1 << 20, 10000000}, {1, 0}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Morton reordering against creation order, at sparse density so agents
+// drift across many cells. Args are {agents, reorder}.
+void BM_SimulatorUpdateReorder(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    RPSSimulator simulator(paramsFor(n, boxSide(n, 2500)), benchSeed);
+    simulator.setSpatialReordering(state.range(1) != 0);
+    for (int warmup = 0; warmup < 20; warmup++) simulator.update();
+    for (auto _ : state) simulator.update();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimulatorUpdateReorder)->ArgsProduct({{1 << 14, 1 << 17}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// Late game, with nearly every agent a rock, with and without inert cells
+// asleep. Args are {agents, sleep}.
+void BM_SimulatorUpdateSleeping(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    params.papers = params.scissors = static_cast<int>(n / 100);
+    params.rocks = static_cast<int>(n) - 2 * params.papers;
+    params.inertSleeping = state.range(1) != 0;
+    RPSSimulator simulator(params, benchSeed);
+    for (auto _ : state) simulator.update();
+    state.counters["asleep"] = static_cast<double>(simulator.getSleepingAgentCount()) / static_cast<double>(n);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimulatorUpdateSleeping)->ArgsProduct({{1 << 14, 1 << 17}, {0, 1}})->Unit(benchmark::kMicrosecond);
+
+// Generations with a stats feed sampling every `interval` generations into
+// a callback sink, against none. Args are {agents, interval}; 0 detaches.
+void BM_SimulatorUpdateStats(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    RPSSimulator simulator(paramsFor(n, boxSide(n, 667)), benchSeed);
+    StatsFeed feed(std::max<int>(1, static_cast<int>(state.range(1))));
+    double clustering = 0.0;
+    feed.subscribe([&](const PopulationSample* batch, size_t count) {
+        for (size_t i = 0; i < count; i++) clustering += batch[i].clustering;
+    });
+    if (state.range(1) > 0) simulator.setStatsFeed(&feed);
+    for (auto _ : state) simulator.update();
+    feed.flush();
+    benchmark::DoNotOptimize(clustering);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SimulatorUpdateStats)->ArgsProduct({{1 << 17}, {0, 1, 100}})->Unit(benchmark::kMicrosecond);
+
+// Full generation under each rule set at the same density. Winner lookups
+// are one table load whatever the type count.
+template <typename RuleSet>
+void BM_RuleSetUpdate(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    SimulationParams params = paramsFor(n, boxSide(n, 667));
+    std::vector<int> counts(RuleSet::typeCount, static_cast<int>(n / RuleSet::typeCount));
+    params.rocks = counts[0];
+    params.papers = counts[1];
+    params.scissors = counts[2];
+    params.extraTypes.assign(counts.begin() + 3, counts.end());
+    BasicRPSSimulator<RuleSet> simulator(params, benchSeed);
+    for (auto _ : state) simulator.update();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_RuleSetUpdate, ClassicRules)->Arg(1 << 14)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_RuleSetUpdate, LizardSpockRules)->Arg(1 << 14)->Unit(benchmark::kMicrosecond);
+
+// All-pairs baseline against the grid on the same worlds
+void BM_BruteForceStep(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    float side = boxSide(n, 667);
+    AgentStore agents;
+    fillAgents(agents, n, side, side);
+    for (auto _ : state) bruteForceStep(agents, side, side);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BruteForceStep)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMicrosecond);
+
+void BM_GridStep(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    RPSSimulator simulator(paramsFor(n, boxSide(n, 667)), benchSeed);
+    for (auto _ : state) simulator.update();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GridStep)->RangeMultiplier(4)->Range(16, 4096)->Unit(benchmark::kMicrosecond);
+
+void BM_GetTypeCounts(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    RPSSimulator simulator(paramsFor(n, boxSide(n, 667)), benchSeed);
+    int rocks, papers, scissors;
+    for (auto _ : state) {
+        simulator.getTypeCounts(rocks, papers, scissors);
+        benchmark::DoNotOptimize(rocks + papers + scissors);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetTypeCounts)->Arg(15)->Arg(1 << 14)->Arg(1 << 20);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,282 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#include "rps_capi.h"
+#include "rps_simulator.h"
+
+#include <cmath>        // For std::isfinite
+#include <limits>       // For std::numeric_limits
+#include <new>          // For std::bad_alloc
+
+// The handle owns the simulator for its rule set; exactly one is set
+struct rps_simulator {
+    std::unique_ptr<RPSSimulator> classic;
+    std::unique_ptr<LizardSpockSimulator> lizardSpock;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+rps_status fail(rps_status status, std::string message) {
+    lastError = std::move(message);
+    return status;
+}
+
+// Call f with whichever simulator the handle holds, const if the handle is
+template <typename Handle, typename Function>
+auto withSimulator(Handle* handle, Function f) {
+    return handle->classic ? f(*handle->classic) : f(*handle->lizardSpock);
+}
+
+// Run f, turning anything the engine throws into a status for the caller
+template <typename Function>
+rps_status guarded(Function f) {
+    try {
+        f();
+        return RPS_OK;
+    } catch (const std::bad_alloc&) {
+        return fail(RPS_ERROR, "out of memory");
+    } catch (const std::exception& e) {
+        return fail(RPS_ERROR, e.what());
+    }
+}
+
+// Check a caller's params the way parseCommandLine checks flags, and
+// translate them. Returns an empty string when they are valid.
+std::string translateParams(const rps_params& in, SimulationParams& out) {
+    if (in.size < sizeof(rps_params)) return "params.size is too small; fill params with rps_params_init";
+    if (in.rules != RPS_RULES_CLASSIC && in.rules != RPS_RULES_LIZARD_SPOCK) {
+        return "params.rules must be RPS_RULES_CLASSIC or RPS_RULES_LIZARD_SPOCK";
+    }
+    if (!(in.box_width > 20 && in.box_height > 20) || !std::isfinite(in.box_width) || !std::isfinite(in.box_height)) {
+        return "the box must be larger than 20x20";
+    }
+    int64_t total = 0;
+    for (int t = 0; t < in.rules; t++) {
+        if (in.counts[t] < 0) return "params.counts must not be negative";
+        total += in.counts[t];
+    }
+    if (total > std::numeric_limits<int>::max()) return "too many agents";
+    if (!(in.timestep > 0) || !std::isfinite(in.timestep)) return "params.timestep must be positive";
+    if (in.spawn_layout < RPS_SPAWN_UNIFORM || in.spawn_layout > RPS_SPAWN_STRIPES) {
+        return "params.spawn_layout must be an rps_spawn_layout";
+    }
+    if (in.groups_per_type < 1) return "params.groups_per_type must be at least 1";
+    if (!(in.cluster_spread > 0) || !std::isfinite(in.cluster_spread)) return "params.cluster_spread must be positive";
+    if (in.velocity != RPS_VELOCITY_UNIFORM && in.velocity != RPS_VELOCITY_FIXED_SPEED) {
+        return "params.velocity must be an rps_velocity";
+    }
+    if (!(in.speed >= 0) || !std::isfinite(in.speed)) return "params.speed must not be negative";
+
+    out.boxWidth = in.box_width;
+    out.boxHeight = in.box_height;
+    out.rocks = in.counts[RPS_ROCK];
+    out.papers = in.counts[RPS_PAPER];
+    out.scissors = in.counts[RPS_SCISSORS];
+    out.extraTypes.assign(in.counts + 3, in.counts + in.rules);
+    out.timestep = in.timestep;
+    out.sweptCollisions = in.swept_collisions != 0;
+    out.inertSleeping = in.inert_sleeping != 0;
+    out.spawn.layout = static_cast<SpawnLayout>(in.spawn_layout);
+    out.spawn.groupsPerType = in.groups_per_type;
+    out.spawn.clusterSpread = in.cluster_spread;
+    out.spawn.velocity = static_cast<VelocityDistribution>(in.velocity);
+    out.spawn.speed = in.speed;
+    out.threads = in.threads;
+    return std::string();
+}
+
+template <typename RuleSet>
+int32_t winnerUnder(int32_t a, int32_t b) {
+    if (a < 0 || b < 0 || a >= RuleSet::typeCount || b >= RuleSet::typeCount) return -1;
+    return RuleSet::winner(static_cast<uint8_t>(a), static_cast<uint8_t>(b));
+}
+
+} // namespace
+
+uint32_t rps_api_version(void) {
+    return RPS_API_VERSION;
+}
+
+const char* rps_last_error(void) {
+    return lastError.c_str();
+}
+
+const char* rps_type_name(int32_t type) {
+    static const char* const names[RPS_MAX_TYPES] = {"Rock", "Paper", "Scissors", "Spock", "Lizard"};
+    return type >= 0 && type < RPS_MAX_TYPES ? names[type] : nullptr;
+}
+
+int32_t rps_rules_winner(int32_t rules, int32_t a, int32_t b) {
+    if (rules == RPS_RULES_CLASSIC) return winnerUnder<ClassicRules>(a, b);
+    if (rules == RPS_RULES_LIZARD_SPOCK) return winnerUnder<LizardSpockRules>(a, b);
+    return -1;
+}
+
+void rps_params_init(rps_params* params) {
+    if (!params) return;
+    SimulationParams defaults;
+    *params = rps_params{};
+    params->size = sizeof(rps_params);
+    params->rules = RPS_RULES_CLASSIC;
+    params->box_width = defaults.boxWidth;
+    params->box_height = defaults.boxHeight;
+    params->counts[RPS_ROCK] = defaults.rocks;
+    params->counts[RPS_PAPER] = defaults.papers;
+    params->counts[RPS_SCISSORS] = defaults.scissors;
+    params->timestep = defaults.timestep;
+    params->spawn_layout = static_cast<int32_t>(defaults.spawn.layout);
+    params->groups_per_type = defaults.spawn.groupsPerType;
+    params->cluster_spread = defaults.spawn.clusterSpread;
+    params->velocity = static_cast<int32_t>(defaults.spawn.velocity);
+    params->speed = defaults.spawn.speed;
+    params->threads = defaults.threads;
+}
+
+rps_status rps_simulator_create(const rps_params* params, uint64_t seed, rps_simulator** out) {
+    if (!params || !out) return fail(RPS_INVALID_ARGUMENT, "params and out must not be null");
+    *out = nullptr;
+    SimulationParams translated;
+    std::string problem = translateParams(*params, translated);
+    if (!problem.empty()) return fail(RPS_INVALID_ARGUMENT, problem);
+
+    return guarded([&] {
+        std::unique_ptr<rps_simulator> handle(new rps_simulator);
+        if (params->rules == RPS_RULES_CLASSIC) {
+            handle->classic.reset(new RPSSimulator(translated, seed));
+        } else {
+            handle->lizardSpock.reset(new LizardSpockSimulator(translated, seed));
+        }
+        withSimulator(handle.get(), [&](auto& simulator) {
+            simulator.setSpatialReordering(params->spatial_reordering != 0);
+        });
+        *out = handle.release();
+    });
+}
+
+void rps_simulator_destroy(rps_simulator* simulator) {
+    delete simulator;
+}
+
+rps_status rps_simulator_step(rps_simulator* simulator, uint32_t generations) {
+    if (!simulator) return fail(RPS_INVALID_ARGUMENT, "simulator must not be null");
+    return guarded([&] {
+        withSimulator(simulator, [&](auto& s) {
+            for (uint32_t g = 0; g < generations; g++) s.update();
+        });
+    });
+}
+
+rps_status rps_simulator_run(rps_simulator* simulator, rps_stop until, uint32_t max_generations,
+                             uint32_t* stepped) {
+    if (stepped) *stepped = 0;
+    if (!simulator) return fail(RPS_INVALID_ARGUMENT, "simulator must not be null");
+    if (until != RPS_STOP_GAME_OVER && until != RPS_STOP_DECIDED) {
+        return fail(RPS_INVALID_ARGUMENT, "until must be an rps_stop");
+    }
+    return guarded([&] {
+        withSimulator(simulator, [&](auto& s) {
+            uint32_t g = 0;
+            while (g < max_generations && !(until == RPS_STOP_DECIDED ? s.isDecided() : s.isGameOver())) {
+                s.update();
+                g++;
+                if (stepped) *stepped = g;
+            }
+        });
+    });
+}
+
+rps_status rps_simulator_set_threads(rps_simulator* simulator, uint32_t threads) {
+    if (!simulator) return fail(RPS_INVALID_ARGUMENT, "simulator must not be null");
+    return guarded([&] {
+        withSimulator(simulator, [&](auto& s) { s.setThreadCount(threads); });
+    });
+}
+
+int32_t rps_simulator_generation(const rps_simulator* simulator) {
+    if (!simulator) return 0;
+    return withSimulator(simulator, [](const auto& s) { return static_cast<int32_t>(s.getGeneration()); });
+}
+
+int32_t rps_simulator_type_count(const rps_simulator* simulator) {
+    if (!simulator) return 0;
+    return withSimulator(simulator, [](const auto& s) {
+        return static_cast<int32_t>(std::decay_t<decltype(s)>::typeCount);
+    });
+}
+
+size_t rps_simulator_agent_count(const rps_simulator* simulator) {
+    if (!simulator) return 0;
+    return withSimulator(simulator, [](const auto& s) { return s.getAgents().size(); });
+}
+
+int32_t rps_simulator_is_game_over(const rps_simulator* simulator) {
+    if (!simulator) return 0;
+    return withSimulator(simulator, [](const auto& s) { return static_cast<int32_t>(s.isGameOver()); });
+}
+
+int32_t rps_simulator_is_decided(const rps_simulator* simulator) {
+    if (!simulator) return 0;
+    return withSimulator(simulator, [](const auto& s) { return static_cast<int32_t>(s.isDecided()); });
+}
+
+int32_t rps_simulator_winner(const rps_simulator* simulator) {
+    if (!simulator) return -1;
+    return withSimulator(simulator, [](const auto& s) {
+        return s.isDecided() ? static_cast<int32_t>(s.getWinner()) : -1;
+    });
+}
+
+double rps_simulator_remaining_generations(const rps_simulator* simulator) {
+    if (!simulator) return 0.0;
+    return withSimulator(simulator, [](const auto& s) { return s.estimateRemainingGenerations(); });
+}
+
+rps_status rps_simulator_population(const rps_simulator* simulator, int32_t* counts, size_t capacity) {
+    if (!simulator || !counts) return fail(RPS_INVALID_ARGUMENT, "simulator and counts must not be null");
+    size_t types = static_cast<size_t>(rps_simulator_type_count(simulator));
+    if (capacity < types) return fail(RPS_BUFFER_TOO_SMALL, "counts needs one element per type");
+    withSimulator(simulator, [&](const auto& s) {
+        for (size_t t = 0; t < types; t++) counts[t] = s.getTypeCount(static_cast<int>(t));
+    });
+    return RPS_OK;
+}
+
+rps_status rps_simulator_sample(const rps_simulator* simulator, rps_sample* sample) {
+    if (!simulator || !sample) return fail(RPS_INVALID_ARGUMENT, "simulator and sample must not be null");
+    return guarded([&] {
+        PopulationSample taken = withSimulator(simulator, [](const auto& s) { return s.samplePopulation(); });
+        *sample = rps_sample{};
+        sample->generation = taken.generation;
+        sample->type_count = taken.typeCount;
+        for (int t = 0; t < taken.typeCount; t++) sample->counts[t] = taken.counts[t];
+        sample->conversion_total = taken.conversionTotal;
+        sample->mean_speed = taken.meanSpeed;
+        sample->clustering = taken.clustering;
+    });
+}
+
+rps_status rps_simulator_agents(const rps_simulator* simulator, float* x, float* y, float* vx, float* vy,
+                                uint8_t* type, size_t capacity, size_t* count) {
+    if (!simulator || !count) return fail(RPS_INVALID_ARGUMENT, "simulator and count must not be null");
+    withSimulator(simulator, [&](const auto& s) {
+        const AgentStore& agents = s.getAgents();
+        size_t n = agents.size();
+        *count = n;
+        if (capacity < n) return;
+        // With spatial reordering on, slot i holds some other agent's state
+        bool inOrder = s.agentsInIdOrder();
+        for (size_t slot = 0; slot < n; slot++) {
+            size_t i = inOrder ? slot : s.getAgentId(slot);
+            if (x) x[i] = agents.x[slot];
+            if (y) y[i] = agents.y[slot];
+            if (vx) vx[i] = agents.vx[slot];
+            if (vy) vy[i] = agents.vy[slot];
+            if (type) type[i] = agents.type[slot];
+        }
+    });
+    if (capacity < *count) return fail(RPS_BUFFER_TOO_SMALL, "the arrays are smaller than the agent count");
+    return RPS_OK;
+}
@@ -0,0 +1,171 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_CAPI_H
+#define RPS_CAPI_H
+
+#include <stddef.h>   // For size_t
+#include <stdint.h>   // For fixed-width integers
+
+// C interface to the simulator, built as librps (see the rps target in
+// CMakeLists.txt) for programs that embed the engine instead of running
+// rps_simulator. Every call returns or fills plain values: the library
+// never hands out memory the caller has to free, besides the simulator
+// handle itself. Functions that can fail return an rps_status, and
+// rps_last_error() describes the most recent failure on the calling
+// thread. A handle may be used from any thread, but from one at a time.
+
+#if defined(_WIN32) && defined(RPS_SHARED)
+#  ifdef RPS_BUILDING_LIBRARY
+#    define RPS_API __declspec(dllexport)
+#  else
+#    define RPS_API __declspec(dllimport)
+#  endif
+#elif defined(RPS_BUILDING_LIBRARY)
+#  define RPS_API __attribute__((visibility("default")))
+#else
+#  define RPS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Bumped whenever a declaration here changes incompatibly
+#define RPS_API_VERSION 1
+
+#define RPS_MAX_TYPES 5
+
+typedef enum rps_status {
+    RPS_OK = 0,
+    RPS_INVALID_ARGUMENT = 1,   // A null handle or out-of-range parameter
+    RPS_BUFFER_TOO_SMALL = 2,   // Nothing was written; the needed size is reported
+    RPS_ERROR = 3               // The engine failed, e.g. out of memory
+} rps_status;
+
+// A rule set's value is its number of types
+typedef enum rps_rules {
+    RPS_RULES_CLASSIC = 3,      // Rock-Paper-Scissors
+    RPS_RULES_LIZARD_SPOCK = 5  // Rock-Paper-Scissors-Spock-Lizard
+} rps_rules;
+
+// Agent types, with the same values as ObjectType
+enum {
+    RPS_ROCK = 0,
+    RPS_PAPER = 1,
+    RPS_SCISSORS = 2,
+    RPS_SPOCK = 3,
+    RPS_LIZARD = 4
+};
+
+typedef enum rps_spawn_layout {
+    RPS_SPAWN_UNIFORM = 0,
+    RPS_SPAWN_CLUSTERED = 1,
+    RPS_SPAWN_STRIPES = 2
+} rps_spawn_layout;
+
+typedef enum rps_velocity {
+    RPS_VELOCITY_UNIFORM = 0,
+    RPS_VELOCITY_FIXED_SPEED = 1
+} rps_velocity;
+
+typedef enum rps_stop {
+    RPS_STOP_GAME_OVER = 0,     // One type left
+    RPS_STOP_DECIDED = 1        // The winner is certain, see rps_simulator_is_decided
+} rps_stop;
+
+// Mirrors SimulationParams. Always fill it with rps_params_init first:
+// `size` tells the library which fields this caller knows about, so
+// fields added in later versions keep their defaults for older callers.
+typedef struct rps_params {
+    uint32_t size;
+    int32_t rules;                      // rps_rules
+    float box_width;                    // Both sides must be larger than 20
+    float box_height;
+    int32_t counts[RPS_MAX_TYPES];      // Starting agents of each type; only the rule set's types are read
+    float timestep;
+    int32_t swept_collisions;           // Non-zero to enable
+    int32_t inert_sleeping;             // Non-zero to enable
+    int32_t spatial_reordering;         // Non-zero to enable
+    int32_t spawn_layout;               // rps_spawn_layout
+    int32_t groups_per_type;
+    float cluster_spread;               // Fraction of the shorter box side
+    int32_t velocity;                   // rps_velocity
+    float speed;
+    uint32_t threads;                   // 0 picks one per hardware thread
+} rps_params;
+
+// Mirrors PopulationSample
+typedef struct rps_sample {
+    int32_t generation;
+    int32_t type_count;
+    int32_t counts[RPS_MAX_TYPES];
+    uint64_t conversion_total;          // Conversions resolved since the simulator was created
+    double mean_speed;
+    double clustering;                  // 0 for a well-mixed box, 1 when every cell holds one type
+} rps_sample;
+
+typedef struct rps_simulator rps_simulator;
+
+RPS_API uint32_t rps_api_version(void);
+
+// Message for the last call on this thread that did not return RPS_OK;
+// valid until that thread's next failing call
+RPS_API const char* rps_last_error(void);
+
+// Display name of a type ("Rock", ...), or NULL if it is out of range
+RPS_API const char* rps_type_name(int32_t type);
+
+// Winner of a contact between types a and b under the rule set, or -1 if
+// either is not one of its types
+RPS_API int32_t rps_rules_winner(int32_t rules, int32_t a, int32_t b);
+
+// The defaults RPSSimulator starts from: the classic rules, five of each
+// type in a 100x100 box
+RPS_API void rps_params_init(rps_params* params);
+
+// Spawn a world; the same params and seed always give the same run.
+// On success *out owns a handle for rps_simulator_destroy.
+RPS_API rps_status rps_simulator_create(const rps_params* params, uint64_t seed, rps_simulator** out);
+RPS_API void rps_simulator_destroy(rps_simulator* simulator);
+
+// Step exactly `generations` generations
+RPS_API rps_status rps_simulator_step(rps_simulator* simulator, uint32_t generations);
+
+// Step until the stop condition holds or max_generations have run, and
+// report how many ran in *stepped (which may be NULL)
+RPS_API rps_status rps_simulator_run(rps_simulator* simulator, rps_stop until, uint32_t max_generations,
+                                     uint32_t* stepped);
+
+RPS_API rps_status rps_simulator_set_threads(rps_simulator* simulator, uint32_t threads);
+
+// Queries on a null handle return 0, or -1 for the winner
+RPS_API int32_t rps_simulator_generation(const rps_simulator* simulator);
+RPS_API int32_t rps_simulator_type_count(const rps_simulator* simulator);
+RPS_API size_t rps_simulator_agent_count(const rps_simulator* simulator);
+RPS_API int32_t rps_simulator_is_game_over(const rps_simulator* simulator);
+RPS_API int32_t rps_simulator_is_decided(const rps_simulator* simulator);
+// The certain winner, or -1 while the game is undecided
+RPS_API int32_t rps_simulator_winner(const rps_simulator* simulator);
+RPS_API double rps_simulator_remaining_generations(const rps_simulator* simulator);
+
+// Agents of each type into counts[0 .. type_count); capacity is in elements
+RPS_API rps_status rps_simulator_population(const rps_simulator* simulator, int32_t* counts, size_t capacity);
+
+// Population statistics, computed on the spot
+RPS_API rps_status rps_simulator_sample(const rps_simulator* simulator, rps_sample* sample);
+
+// Copy the agent state into caller-owned arrays of `capacity` elements,
+// agent i at index i whatever order the engine keeps them in. Any array
+// may be NULL to skip it. *count is always set to the agent count; if
+// that exceeds capacity, nothing is written and RPS_BUFFER_TOO_SMALL is
+// returned, so passing capacity 0 queries the size.
+RPS_API rps_status rps_simulator_agents(const rps_simulator* simulator, float* x, float* y, float* vx, float* vy,
+                                        uint8_t* type, size_t capacity, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //RPS_CAPI_H
@@ -0,0 +1,103 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_CUDA_H
+#define RPS_CUDA_H
+
+#include "rps_simulator.h"
+#include "rps_cuda_kernels.h"
+
+// GPU backend for the classic game, built with -DRPS_ENABLE_CUDA=ON.
+// It steps like RPSSimulator, but the agent arrays stay resident on the
+// device. Each update() copies back only the type counts; getAgents()
+// downloads the full state on demand and caches it until the next step.
+//
+// Agents start exactly as RPSSimulator places them for the same params
+// and seed. Contacts are then resolved simultaneously on the device
+// rather than pair by pair (see rps_cuda_kernels.cu), so runs match the
+// CPU engine in distribution, not agent for agent. Per-agent radii,
+// swept collisions and conversion logs are CPU-only.
+class CudaRPSSimulator {
+private:
+    std::unique_ptr<CudaWorld, void (*)(CudaWorld*)> world{nullptr, cudaWorldDestroy};
+    mutable AgentStore hostAgents;      // Last downloaded state
+    mutable bool hostCurrent = true;
+    float boxWidth, boxHeight;
+    uint64_t seed;
+    int generation = 0;
+    int typeCounts[ClassicRules::typeCount] = {};
+
+public:
+    static constexpr int typeCount = ClassicRules::typeCount;
+
+    // Throws std::runtime_error if there is no usable device
+    CudaRPSSimulator(const SimulationParams& params, uint64_t seed)
+        : boxWidth(params.boxWidth), boxHeight(params.boxHeight), seed(seed) {
+        RPSSimulator start(params, seed);
+        hostAgents = start.getAgents();
+        start.getTypeCounts(typeCounts[0], typeCounts[1], typeCounts[2]);
+
+        CudaWorldParams device;
+        device.boxWidth = boxWidth;
+        device.boxHeight = boxHeight;
+        device.radius = hostAgents.radius;
+        device.timestep = params.timestep;
+        device.separation = GameRules::separationForce;
+        device.typeCount = typeCount;
+        device.winner = ClassicRules::table.winner;
+        world.reset(cudaWorldCreate(device, hostAgents.size(), hostAgents.x.data(), hostAgents.y.data(),
+                                    hostAgents.vx.data(), hostAgents.vy.data(), hostAgents.type.data()));
+    }
+
+    void update() {
+        cudaWorldStep(world.get(), typeCounts);
+        generation++;
+        hostCurrent = false;
+    }
+
+    int getGeneration() const { return generation; }
+
+    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
+        rocks = typeCounts[static_cast<int>(ObjectType::ROCK)];
+        papers = typeCounts[static_cast<int>(ObjectType::PAPER)];
+        scissors = typeCounts[static_cast<int>(ObjectType::SCISSORS)];
+    }
+
+    int getTypeCount(int type) const { return typeCounts[type]; }
+
+    bool isGameOver() const {
+        int nonZeroCount = 0;
+        for (int t = 0; t < typeCount; t++) nonZeroCount += typeCounts[t] > 0;
+        return nonZeroCount <= 1;
+    }
+
+    bool isDecided() const {
+        ObjectType winner;
+        return GameRules::decidedWinner(typeCounts, winner);
+    }
+
+    ObjectType getWinner() const {
+        ObjectType winner;
+        if (GameRules::decidedWinner(typeCounts, winner)) return winner;
+        return ObjectType::ROCK; // Fallback
+    }
+
+    // Full agent state, downloaded from the device if it has stepped since
+    // the last call
+    const AgentStore& getAgents() const {
+        if (!hostCurrent) {
+            cudaWorldDownload(world.get(), hostAgents.x.data(), hostAgents.y.data(), hostAgents.vx.data(),
+                              hostAgents.vy.data(), hostAgents.type.data());
+            hostCurrent = true;
+        }
+        return hostAgents;
+    }
+
+    uint64_t getSeed() const { return seed; }
+    float getBoxWidth() const { return boxWidth; }
+    float getBoxHeight() const { return boxHeight; }
+    static const char* getDeviceName() { return cudaDeviceName(); }
+};
+
+#endif //RPS_CUDA_H
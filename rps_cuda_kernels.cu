@@ -0,0 +1,317 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#include "rps_cuda_kernels.h"
+
+#include <cuda_runtime.h>
+#include <cub/device/device_radix_sort.cuh>   // For binning agents by cell
+
+#include <algorithm>
+#include <stdexcept>     // For reporting CUDA errors
+#include <string>
+
+// One generation on the device:
+//   1. move and bounce every agent (one thread per agent)
+//   2. key each agent by its grid cell and radix-sort the (cell, agent) pairs
+//   3. mark where each cell's run starts and ends in the sorted order
+//   4. gather positions and types into sorted order, so neighbours are
+//      read from contiguous memory
+//   5. resolve contacts, one thread per agent over its 3x3 cells
+//   6. histogram the types and copy the counts back
+//
+// Contacts are resolved simultaneously from the positions after the move:
+// an agent takes the type of the lowest-indexed touching agent that beats
+// it and is pushed away from every agent it touches. The CPU engine
+// resolves pairs one at a time in index order, so runs differ agent by
+// agent but agree statistically.
+
+struct CudaWorld {
+    CudaWorldParams params{};
+    size_t n = 0;
+    int cols = 0, rows = 0;
+    float cellSize = 1.0f;
+    int keyBits = 1;
+    cudaStream_t stream = nullptr;
+
+    float* x = nullptr;
+    float* y = nullptr;
+    float* vx = nullptr;
+    float* vy = nullptr;
+    uint8_t* type = nullptr;
+
+    uint32_t* keys = nullptr;
+    uint32_t* sortedKeys = nullptr;
+    uint32_t* ids = nullptr;
+    uint32_t* sortedIds = nullptr;
+    uint32_t* cellStart = nullptr;
+    uint32_t* cellEnd = nullptr;
+    float* sortedX = nullptr;
+    float* sortedY = nullptr;
+    uint8_t* sortedType = nullptr;
+    void* sortTemp = nullptr;
+    size_t sortTempBytes = 0;
+
+    int* counts = nullptr;
+    int* hostCounts = nullptr;    // Pinned, so the copy back is a plain DMA
+};
+
+namespace {
+
+constexpr int blockSize = 256;
+constexpr int maxTypes = 16;
+
+__constant__ uint8_t winnerTable[maxTypes * maxTypes];
+
+void check(cudaError_t status, const char* what) {
+    if (status != cudaSuccess) throw std::runtime_error(std::string(what) + ": " + cudaGetErrorString(status));
+}
+
+template <typename T>
+T* deviceArray(size_t count) {
+    void* p = nullptr;
+    check(cudaMalloc(&p, std::max<size_t>(1, count) * sizeof(T)), "cudaMalloc");
+    return static_cast<T*>(p);
+}
+
+unsigned blocksFor(size_t n) {
+    return static_cast<unsigned>((n + blockSize - 1) / blockSize);
+}
+
+__device__ size_t threadIndex() {
+    return static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+}
+
+__device__ int cellCoord(float v, float cellSize, int count) {
+    return max(0, min(count - 1, static_cast<int>(floorf(v / cellSize))));
+}
+
+// Same arithmetic as GameObject::update followed by handleBoundaries
+__global__ void moveKernel(float* x, float* y, float* vx, float* vy, size_t n, float timestep, float radius,
+                           float width, float height) {
+    size_t i = threadIndex();
+    if (i >= n) return;
+    float px = x[i] + vx[i] * timestep;
+    float py = y[i] + vy[i] * timestep;
+    if (px - radius <= 0 || px + radius >= width) {
+        vx[i] = -vx[i];
+        px = fmaxf(radius, fminf(width - radius, px));
+    }
+    if (py - radius <= 0 || py + radius >= height) {
+        vy[i] = -vy[i];
+        py = fmaxf(radius, fminf(height - radius, py));
+    }
+    x[i] = px;
+    y[i] = py;
+}
+
+__global__ void cellKeyKernel(const float* x, const float* y, size_t n, float cellSize, int cols, int rows,
+                              uint32_t* keys, uint32_t* ids) {
+    size_t i = threadIndex();
+    if (i >= n) return;
+    keys[i] = static_cast<uint32_t>(cellCoord(y[i], cellSize, rows) * cols + cellCoord(x[i], cellSize, cols));
+    ids[i] = static_cast<uint32_t>(i);
+}
+
+// Each cell's run in the sorted order is [cellStart, cellEnd); empty
+// cells keep the 0, 0 they were cleared to
+__global__ void cellRangeKernel(const uint32_t* sortedKeys, size_t n, uint32_t* cellStart, uint32_t* cellEnd) {
+    size_t s = threadIndex();
+    if (s >= n) return;
+    uint32_t key = sortedKeys[s];
+    if (s == 0 || sortedKeys[s - 1] != key) cellStart[key] = static_cast<uint32_t>(s);
+    if (s == n - 1 || sortedKeys[s + 1] != key) cellEnd[key] = static_cast<uint32_t>(s + 1);
+}
+
+__global__ void gatherKernel(const float* x, const float* y, const uint8_t* type, const uint32_t* sortedIds, size_t n,
+                             float* sortedX, float* sortedY, uint8_t* sortedType) {
+    size_t s = threadIndex();
+    if (s >= n) return;
+    uint32_t i = sortedIds[s];
+    sortedX[s] = x[i];
+    sortedY[s] = y[i];
+    sortedType[s] = type[i];
+}
+
+// Reads only the sorted copies and writes only agent i, so threads never race
+__global__ void resolveKernel(const float* sortedX, const float* sortedY, const uint8_t* sortedType,
+                              const uint32_t* sortedIds, const uint32_t* cellStart, const uint32_t* cellEnd,
+                              size_t n, float cellSize, int cols, int rows, float contact, float separation,
+                              int typeCount, float* x, float* y, uint8_t* type) {
+    size_t s = threadIndex();
+    if (s >= n) return;
+    float xi = sortedX[s], yi = sortedY[s];
+    uint8_t ti = sortedType[s];
+    int cx = cellCoord(xi, cellSize, cols), cy = cellCoord(yi, cellSize, rows);
+
+    float pushX = 0.0f, pushY = 0.0f;
+    uint8_t newType = ti;
+    uint32_t converter = 0xffffffffu;
+    for (int ny = max(0, cy - 1); ny <= min(rows - 1, cy + 1); ny++) {
+        for (int nx = max(0, cx - 1); nx <= min(cols - 1, cx + 1); nx++) {
+            int cell = ny * cols + nx;
+            for (uint32_t k = cellStart[cell]; k < cellEnd[cell]; k++) {
+                if (k == s) continue;
+                float dx = xi - sortedX[k], dy = yi - sortedY[k];
+                float distanceSq = dx * dx + dy * dy;
+                if (distanceSq >= contact * contact) continue;
+
+                uint8_t winner = winnerTable[ti * typeCount + sortedType[k]];
+                if (winner != ti && sortedIds[k] < converter) {
+                    converter = sortedIds[k];
+                    newType = winner;
+                }
+                float distance = sqrtf(distanceSq);
+                if (distance > 0) {
+                    pushX += dx / distance * separation;
+                    pushY += dy / distance * separation;
+                }
+            }
+        }
+    }
+
+    uint32_t i = sortedIds[s];
+    x[i] = xi + pushX;
+    y[i] = yi + pushY;
+    type[i] = newType;
+}
+
+__global__ void countKernel(const uint8_t* type, size_t n, int typeCount, int* counts) {
+    __shared__ int blockCounts[maxTypes];
+    const int t = static_cast<int>(threadIdx.x);
+    if (t < typeCount) blockCounts[t] = 0;
+    __syncthreads();
+    size_t i = threadIndex();
+    if (i < n) atomicAdd(&blockCounts[type[i]], 1);
+    __syncthreads();
+    if (t < typeCount && blockCounts[t] > 0) atomicAdd(&counts[t], blockCounts[t]);
+}
+
+}  // namespace
+
+CudaWorld* cudaWorldCreate(const CudaWorldParams& params, size_t n, const float* x, const float* y,
+                           const float* vx, const float* vy, const uint8_t* type) {
+    if (params.typeCount > maxTypes) throw std::runtime_error("the CUDA backend supports at most 16 types");
+    if (n >= (size_t(1) << 31)) throw std::runtime_error("the CUDA backend supports fewer than 2^31 agents");
+
+    CudaWorld* world = new CudaWorld();
+    try {
+        world->params = params;
+        world->n = n;
+
+        // Cells just cover a contact, capped relative to the agent count
+        // like the CPU grid so a sparse box does not pay for empty cells
+        size_t maxCells = std::max<size_t>(64, 4 * n);
+        world->cellSize = 2.0f * params.radius;
+        do {
+            world->cols = std::max(1, static_cast<int>(std::ceil(params.boxWidth / world->cellSize)));
+            world->rows = std::max(1, static_cast<int>(std::ceil(params.boxHeight / world->cellSize)));
+            if (static_cast<size_t>(world->cols) * world->rows <= maxCells) break;
+            world->cellSize *= 2.0f;
+        } while (true);
+        size_t cellCount = static_cast<size_t>(world->cols) * world->rows;
+        while ((size_t(1) << world->keyBits) < cellCount) world->keyBits++;
+
+        check(cudaStreamCreate(&world->stream), "cudaStreamCreate");
+        world->x = deviceArray<float>(n);
+        world->y = deviceArray<float>(n);
+        world->vx = deviceArray<float>(n);
+        world->vy = deviceArray<float>(n);
+        world->type = deviceArray<uint8_t>(n);
+        world->keys = deviceArray<uint32_t>(n);
+        world->sortedKeys = deviceArray<uint32_t>(n);
+        world->ids = deviceArray<uint32_t>(n);
+        world->sortedIds = deviceArray<uint32_t>(n);
+        world->cellStart = deviceArray<uint32_t>(cellCount);
+        world->cellEnd = deviceArray<uint32_t>(cellCount);
+        world->sortedX = deviceArray<float>(n);
+        world->sortedY = deviceArray<float>(n);
+        world->sortedType = deviceArray<uint8_t>(n);
+        world->counts = deviceArray<int>(maxTypes);
+        check(cudaMallocHost(reinterpret_cast<void**>(&world->hostCounts), maxTypes * sizeof(int)), "cudaMallocHost");
+
+        check(cub::DeviceRadixSort::SortPairs(nullptr, world->sortTempBytes, world->keys, world->sortedKeys,
+                                              world->ids, world->sortedIds, static_cast<int>(n), 0,
+                                              world->keyBits, world->stream),
+              "sizing the radix sort");
+        world->sortTemp = deviceArray<unsigned char>(world->sortTempBytes);
+
+        check(cudaMemcpyToSymbol(winnerTable, params.winner, params.typeCount * params.typeCount), "uploading rules");
+        world->params.winner = nullptr;   // Only the device copy is used from here on
+        check(cudaMemcpy(world->x, x, n * sizeof(float), cudaMemcpyHostToDevice), "uploading agents");
+        check(cudaMemcpy(world->y, y, n * sizeof(float), cudaMemcpyHostToDevice), "uploading agents");
+        check(cudaMemcpy(world->vx, vx, n * sizeof(float), cudaMemcpyHostToDevice), "uploading agents");
+        check(cudaMemcpy(world->vy, vy, n * sizeof(float), cudaMemcpyHostToDevice), "uploading agents");
+        check(cudaMemcpy(world->type, type, n, cudaMemcpyHostToDevice), "uploading agents");
+    } catch (...) {
+        cudaWorldDestroy(world);
+        throw;
+    }
+    return world;
+}
+
+void cudaWorldDestroy(CudaWorld* world) {
+    if (!world) return;
+    void* arrays[] = {world->x, world->y, world->vx, world->vy, world->type, world->keys, world->sortedKeys,
+                      world->ids, world->sortedIds, world->cellStart, world->cellEnd, world->sortedX,
+                      world->sortedY, world->sortedType, world->sortTemp, world->counts};
+    for (void* p : arrays) cudaFree(p);
+    cudaFreeHost(world->hostCounts);
+    if (world->stream) cudaStreamDestroy(world->stream);
+    delete world;
+}
+
+void cudaWorldStep(CudaWorld* world, int* typeCounts) {
+    const size_t n = world->n;
+    const CudaWorldParams& p = world->params;
+    const int typeCount = p.typeCount;
+    cudaStream_t stream = world->stream;
+    if (n > 0) {
+        const unsigned blocks = blocksFor(n);
+        const size_t cellBytes = static_cast<size_t>(world->cols) * world->rows * sizeof(uint32_t);
+
+        moveKernel<<<blocks, blockSize, 0, stream>>>(world->x, world->y, world->vx, world->vy, n, p.timestep,
+                                                     p.radius, p.boxWidth, p.boxHeight);
+        cellKeyKernel<<<blocks, blockSize, 0, stream>>>(world->x, world->y, n, world->cellSize, world->cols,
+                                                        world->rows, world->keys, world->ids);
+        check(cub::DeviceRadixSort::SortPairs(world->sortTemp, world->sortTempBytes, world->keys, world->sortedKeys,
+                                              world->ids, world->sortedIds, static_cast<int>(n), 0,
+                                              world->keyBits, stream),
+              "sorting agents by cell");
+        check(cudaMemsetAsync(world->cellStart, 0, cellBytes, stream), "clearing cells");
+        check(cudaMemsetAsync(world->cellEnd, 0, cellBytes, stream), "clearing cells");
+        cellRangeKernel<<<blocks, blockSize, 0, stream>>>(world->sortedKeys, n, world->cellStart, world->cellEnd);
+        gatherKernel<<<blocks, blockSize, 0, stream>>>(world->x, world->y, world->type, world->sortedIds, n,
+                                                       world->sortedX, world->sortedY, world->sortedType);
+        resolveKernel<<<blocks, blockSize, 0, stream>>>(world->sortedX, world->sortedY, world->sortedType,
+                                                        world->sortedIds, world->cellStart, world->cellEnd, n,
+                                                        world->cellSize, world->cols, world->rows,
+                                                        2.0f * p.radius, p.separation, typeCount,
+                                                        world->x, world->y, world->type);
+    }
+    check(cudaMemsetAsync(world->counts, 0, typeCount * sizeof(int), stream), "clearing counts");
+    if (n > 0) countKernel<<<blocksFor(n), blockSize, 0, stream>>>(world->type, n, typeCount, world->counts);
+    check(cudaGetLastError(), "launching a generation");
+    check(cudaMemcpyAsync(world->hostCounts, world->counts, typeCount * sizeof(int), cudaMemcpyDeviceToHost, stream),
+          "copying counts back");
+    check(cudaStreamSynchronize(stream), "running a generation");
+    std::copy(world->hostCounts, world->hostCounts + typeCount, typeCounts);
+}
+
+void cudaWorldDownload(const CudaWorld* world, float* x, float* y, float* vx, float* vy, uint8_t* type) {
+    const size_t n = world->n;
+    check(cudaStreamSynchronize(world->stream), "finishing the last generation");
+    check(cudaMemcpy(x, world->x, n * sizeof(float), cudaMemcpyDeviceToHost), "downloading agents");
+    check(cudaMemcpy(y, world->y, n * sizeof(float), cudaMemcpyDeviceToHost), "downloading agents");
+    check(cudaMemcpy(vx, world->vx, n * sizeof(float), cudaMemcpyDeviceToHost), "downloading agents");
+    check(cudaMemcpy(vy, world->vy, n * sizeof(float), cudaMemcpyDeviceToHost), "downloading agents");
+    check(cudaMemcpy(type, world->type, n, cudaMemcpyDeviceToHost), "downloading agents");
+}
+
+const char* cudaDeviceName() {
+    static cudaDeviceProp properties;
+    int device = 0;
+    check(cudaGetDevice(&device), "cudaGetDevice");
+    check(cudaGetDeviceProperties(&properties, device), "cudaGetDeviceProperties");
+    return properties.name;
+}
@@ -0,0 +1,44 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_CUDA_KERNELS_H
+#define RPS_CUDA_KERNELS_H
+
+// Device side of the CUDA backend. This header has no CUDA or simulator
+// dependencies, so only rps_cuda_kernels.cu goes through nvcc and the host
+// code keeps building with the normal compiler. Every function throws
+// std::runtime_error if a CUDA call fails.
+
+#include <cstddef>       // For agent counts
+#include <cstdint>       // For packed agent types
+
+// Agent arrays and scratch resident on the device; opaque to the host
+struct CudaWorld;
+
+struct CudaWorldParams {
+    float boxWidth, boxHeight;
+    float radius;            // Shared by every agent
+    float timestep;          // Fraction of its velocity each agent moves per generation
+    float separation;        // Push applied to each agent per contact
+    int typeCount;
+    const uint8_t* winner;   // typeCount x typeCount table, winner[a * typeCount + b]
+};
+
+// Upload n agents and allocate everything a generation needs
+CudaWorld* cudaWorldCreate(const CudaWorldParams& params, size_t n, const float* x, const float* y,
+                           const float* vx, const float* vy, const uint8_t* type);
+
+void cudaWorldDestroy(CudaWorld* world);
+
+// Advance one generation on the device. Only the per-type populations are
+// copied back, into typeCounts[params.typeCount].
+void cudaWorldStep(CudaWorld* world, int* typeCounts);
+
+// Copy the full agent state back to the host
+void cudaWorldDownload(const CudaWorld* world, float* x, float* y, float* vx, float* vy, uint8_t* type);
+
+// Name of the device the worlds run on
+const char* cudaDeviceName();
+
+#endif //RPS_CUDA_KERNELS_H
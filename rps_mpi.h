@@ -0,0 +1,383 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_MPI_H
+#define RPS_MPI_H
+
+#include "rps_simulator.h"
+
+#include <mpi.h>         // For exchanging agents between ranks
+
+// Distributed backend, built with -DRPS_ENABLE_MPI=ON. The box is cut into
+// vertical slabs, one per rank, and each rank owns the agents whose x falls
+// in its slab. A generation:
+//
+//   1. moves and bounces the owned agents,
+//   2. migrates agents that crossed into a neighbouring slab,
+//   3. posts non-blocking sends of the halo bands along each shared edge,
+//   4. resolves pairs between agents clear of the bands while those are
+//      in flight,
+//   5. waits for the neighbours' halos and resolves the pairs that touch a
+//      band, against ghost copies of the neighbours' agents,
+//   6. sums the type counts over every rank.
+//
+// Agents start exactly as BasicRPSSimulator places them for the same params
+// and seed. Each rank only keeps the outcome for its own agent of a
+// cross-edge pair, and both sides resolve it against the other's state
+// from the start of the pass, so runs match the single-process engine in
+// distribution rather than agent for agent. Type counts are always exact:
+// every agent is owned and counted by exactly one rank.
+template <typename RuleSet>
+class BasicDistributedSimulator {
+public:
+    static constexpr int typeCount = RuleSet::typeCount;
+
+private:
+    using GameRules = BasicGameRules<RuleSet>;
+
+    // One agent on the wire. Ranks are assumed to share a byte layout.
+    struct AgentRecord {
+        uint64_t id;
+        float x, y, vx, vy;
+        uint8_t type;
+    };
+
+    // Records bound for and arriving from the left (0) and right (1)
+    // neighbours. Counts go first so the payload receives can be sized.
+    struct Exchange {
+        int tag;
+        std::vector<AgentRecord> send[2];
+        std::vector<AgentRecord> recv[2];
+        MPI_Request requests[4];
+    };
+
+    MPI_Comm comm;
+    int rank = 0, rankCount = 1;
+    int neighbour[2];
+    float boxWidth, boxHeight;
+    float sliceMin, sliceMax;      // This rank owns sliceMin <= x < sliceMax
+    float haloWidth;               // Band along a shared edge whose agents can touch the other side
+    float timestep;
+    uint64_t seed;
+    int generation = 0;
+
+    AgentStore agents;             // Owned agents
+    std::vector<uint64_t> ids;     // Global index of each owned agent
+    int typeCounts[typeCount] = {};
+
+    // Scratch reused every generation
+    Exchange migration{1, {}, {}, {}};
+    Exchange halo{3, {}, {}, {}};
+    std::vector<uint8_t> inBand;   // Owned agent lies within haloWidth of a shared edge
+    std::vector<int> members;
+    AgentStore boundary;           // Owned agents near an edge, then the ghosts
+    std::vector<int> boundaryOwner;  // Owned index of each boundary slot, -1 for a ghost
+    SpatialGrid grid;
+    std::vector<int> candidates;
+
+    float sliceEdge(int r) const {
+        return r == rankCount ? boxWidth : boxWidth * static_cast<float>(r) / static_cast<float>(rankCount);
+    }
+
+    bool owns(float x) const {
+        return x >= sliceMin && (x < sliceMax || rank == rankCount - 1);
+    }
+
+    bool hasNeighbour(int side) const { return neighbour[side] != MPI_PROC_NULL; }
+
+    float distanceToEdge(int side, float x) const { return side == 0 ? x - sliceMin : sliceMax - x; }
+
+    AgentRecord record(size_t i) const {
+        return {ids[i], agents.x[i], agents.y[i], agents.vx[i], agents.vy[i], agents.type[i]};
+    }
+
+    static void addRecord(AgentStore& store, const AgentRecord& r) {
+        store.add(static_cast<ObjectType>(r.type), r.x, r.y, r.vx, r.vy);
+    }
+
+    static void check(int status, const char* what) {
+        if (status != MPI_SUCCESS) throw std::runtime_error(std::string("MPI error while ") + what);
+    }
+
+    // Swap counts with both neighbours, then post the payload receives and
+    // sends without waiting for them. finishExchange completes them.
+    void startExchange(Exchange& ex) {
+        int sendCount[2], recvCount[2] = {0, 0};
+        MPI_Request countRequests[4];
+        for (int side = 0; side < 2; side++) {
+            sendCount[side] = static_cast<int>(ex.send[side].size());
+            check(MPI_Irecv(&recvCount[side], 1, MPI_INT, neighbour[side], ex.tag, comm, &countRequests[side]),
+                  "receiving counts");
+            check(MPI_Isend(&sendCount[side], 1, MPI_INT, neighbour[side], ex.tag, comm, &countRequests[2 + side]),
+                  "sending counts");
+        }
+        check(MPI_Waitall(4, countRequests, MPI_STATUSES_IGNORE), "exchanging counts");
+
+        const int recordBytes = static_cast<int>(sizeof(AgentRecord));
+        for (int side = 0; side < 2; side++) {
+            ex.recv[side].resize(recvCount[side]);
+            check(MPI_Irecv(ex.recv[side].data(), recvCount[side] * recordBytes, MPI_BYTE, neighbour[side],
+                            ex.tag + 1, comm, &ex.requests[side]), "receiving agents");
+            check(MPI_Isend(ex.send[side].data(), sendCount[side] * recordBytes, MPI_BYTE, neighbour[side],
+                            ex.tag + 1, comm, &ex.requests[2 + side]), "sending agents");
+        }
+    }
+
+    void finishExchange(Exchange& ex) {
+        check(MPI_Waitall(4, ex.requests, MPI_STATUSES_IGNORE), "exchanging agents");
+    }
+
+    void moveAgents() {
+        const size_t n = agents.size();
+        if (timestep != 1.0f) {
+            for (size_t i = 0; i < n; i++) {
+                agents.x[i] += agents.vx[i] * timestep;
+                agents.y[i] += agents.vy[i] * timestep;
+            }
+        } else {
+            const MoveKernels& kernels = MoveKernels::active();
+            kernels.integrate(agents.x.data(), agents.vx.data(), n);
+            kernels.integrate(agents.y.data(), agents.vy.data(), n);
+        }
+        const MoveKernels& kernels = MoveKernels::active();
+        kernels.reflect(agents.x.data(), agents.vx.data(), nullptr, agents.radius, n, boxWidth);
+        kernels.reflect(agents.y.data(), agents.vy.data(), nullptr, agents.radius, n, boxHeight);
+    }
+
+    // Hand agents that left the slab to the neighbour on that side. Agents
+    // move at most a few units a generation, far less than a slab, so they
+    // only ever cross into the adjacent one.
+    void migrateAgents() {
+        migration.send[0].clear();
+        migration.send[1].clear();
+        size_t kept = 0;
+        for (size_t i = 0; i < agents.size(); i++) {
+            int side = agents.x[i] < sliceMin ? 0 : (agents.x[i] >= sliceMax ? 1 : -1);
+            if (side >= 0 && hasNeighbour(side)) {
+                migration.send[side].push_back(record(i));
+                continue;
+            }
+            if (kept != i) {
+                agents.x[kept] = agents.x[i];
+                agents.y[kept] = agents.y[i];
+                agents.vx[kept] = agents.vx[i];
+                agents.vy[kept] = agents.vy[i];
+                agents.type[kept] = agents.type[i];
+                ids[kept] = ids[i];
+            }
+            kept++;
+        }
+        agents.resize(kept);
+        ids.resize(kept);
+
+        startExchange(migration);
+        finishExchange(migration);
+        for (const auto& arrivals : migration.recv) {
+            for (const AgentRecord& r : arrivals) {
+                addRecord(agents, r);
+                ids.push_back(r.id);
+            }
+        }
+    }
+
+    // Mark the band agents and send them to the neighbour they border
+    void startHalo() {
+        halo.send[0].clear();
+        halo.send[1].clear();
+        inBand.assign(agents.size(), 0);
+        for (size_t i = 0; i < agents.size(); i++) {
+            for (int side = 0; side < 2; side++) {
+                if (hasNeighbour(side) && distanceToEdge(side, agents.x[i]) < haloWidth) {
+                    inBand[i] = 1;
+                    halo.send[side].push_back(record(i));
+                }
+            }
+        }
+        startExchange(halo);
+    }
+
+    // Scan pairs among the store's agents in grid order. skip(a, b) drops
+    // pairs that belong to the other pass.
+    template <typename Skip>
+    void resolvePairs(AgentStore& store, const int* slots, size_t count, float minX, float maxX, Skip skip) {
+        if (count == 0) return;
+        grid.build(store, slots, count, minX, 0.0f, maxX, boxHeight,
+                   2.0f * store.radius + 2.0f * GameRules::separationForce);
+        for (size_t s = 0; s < count; s++) {
+            size_t a = slots ? slots[s] : s;
+            grid.query(store.x[a], store.y[a], static_cast<int>(s), candidates);
+            for (int c : candidates) {
+                size_t b = slots ? slots[c] : c;
+                if (skip(a, b) || !agentsTouch(store, a, b)) continue;
+                GameObject obj1 = store[a];
+                GameObject obj2 = store[b];
+                GameRules::resolveCollision(obj1, obj2);
+            }
+        }
+    }
+
+    // Pairs between owned agents that are both clear of the bands. Nothing
+    // from a neighbour can reach them, so this runs while the halo is in flight.
+    void resolveInterior() {
+        members.clear();
+        for (size_t i = 0; i < agents.size(); i++) {
+            if (!inBand[i]) members.push_back(static_cast<int>(i));
+        }
+        resolvePairs(agents, members.data(), members.size(), sliceMin, sliceMax,
+                     [](size_t, size_t) { return false; });
+    }
+
+    // Pairs with a band agent on at least one side: owned agents within two
+    // halo widths of a shared edge against each other and the ghosts
+    void resolveBoundary() {
+        boundary.clear();
+        boundary.radius = agents.radius;
+        boundaryOwner.clear();
+        for (size_t i = 0; i < agents.size(); i++) {
+            for (int side = 0; side < 2; side++) {
+                if (hasNeighbour(side) && distanceToEdge(side, agents.x[i]) < 2.0f * haloWidth) {
+                    boundary.add(static_cast<ObjectType>(agents.type[i]), agents.x[i], agents.y[i],
+                                 agents.vx[i], agents.vy[i]);
+                    boundaryOwner.push_back(static_cast<int>(i));
+                    break;
+                }
+            }
+        }
+        for (const auto& ghosts : halo.recv) {
+            for (const AgentRecord& r : ghosts) {
+                addRecord(boundary, r);
+                boundaryOwner.push_back(-1);
+            }
+        }
+
+        resolvePairs(boundary, nullptr, boundary.size(), sliceMin - haloWidth, sliceMax + haloWidth,
+                     [&](size_t a, size_t b) {
+                         int ownerA = boundaryOwner[a], ownerB = boundaryOwner[b];
+                         if (ownerA < 0 && ownerB < 0) return true;   // The neighbours' own business
+                         return ownerA >= 0 && ownerB >= 0 && !inBand[ownerA] && !inBand[ownerB];
+                     });
+
+        for (size_t k = 0; k < boundary.size(); k++) {
+            int i = boundaryOwner[k];
+            if (i < 0) continue;
+            agents.x[i] = boundary.x[k];
+            agents.y[i] = boundary.y[k];
+            agents.type[i] = boundary.type[k];
+        }
+    }
+
+    void reduceTypeCounts() {
+        int local[typeCount] = {};
+        for (uint8_t t : agents.type) local[t]++;
+        check(MPI_Allreduce(local, typeCounts, typeCount, MPI_INT, MPI_SUM, comm), "summing type counts");
+    }
+
+public:
+    // Collective: every rank in comm must construct with the same params and
+    // seed. Throws std::runtime_error if the slabs would be narrower than
+    // two halo widths or swept collisions are requested.
+    BasicDistributedSimulator(const SimulationParams& params, uint64_t seed, MPI_Comm comm = MPI_COMM_WORLD)
+        : comm(comm), boxWidth(params.boxWidth), boxHeight(params.boxHeight),
+          timestep(params.timestep), seed(seed) {
+        if (params.sweptCollisions) {
+            throw std::runtime_error("swept collisions are not supported by the distributed backend");
+        }
+        check(MPI_Comm_rank(comm, &rank), "querying the rank");
+        check(MPI_Comm_size(comm, &rankCount), "querying the rank count");
+        neighbour[0] = rank > 0 ? rank - 1 : MPI_PROC_NULL;
+        neighbour[1] = rank + 1 < rankCount ? rank + 1 : MPI_PROC_NULL;
+        sliceMin = sliceEdge(rank);
+        sliceMax = sliceEdge(rank + 1);
+        haloWidth = 2.0f * agents.radius + 2.0f * GameRules::separationForce;
+        if (rankCount > 1 && boxWidth / rankCount < 2.0f * haloWidth) {
+            throw std::runtime_error("box is too narrow for " + std::to_string(rankCount) +
+                                     " ranks; each slab needs to be at least " +
+                                     std::to_string(static_cast<int>(std::ceil(2.0f * haloWidth))) + " wide");
+        }
+
+        // Walk every agent in BasicRPSSimulator's order and keep our own
+        int counts[typeCount] = {params.rocks, params.papers, params.scissors};
+        for (int t = 3; t < typeCount && t - 3 < static_cast<int>(params.extraTypes.size()); t++) {
+            counts[t] = params.extraTypes[t - 3];
+        }
+        int most = *std::max_element(counts, counts + typeCount);
+        CounterRng rng(seed);
+        const Spawner spawner(rng, params.spawn, 0, typeCount, boxWidth, boxHeight);
+        uint64_t index = 0;
+        for (int i = 0; i < most; i++) {
+            for (int t = 0; t < typeCount; t++) {
+                if (i >= counts[t]) continue;
+                float x, y, vx, vy;
+                spawner.spawn(index, t, x, y, vx, vy);
+                if (owns(x)) {
+                    agents.add(static_cast<ObjectType>(t), x, y, vx, vy);
+                    ids.push_back(index);
+                }
+                index++;
+            }
+        }
+        reduceTypeCounts();
+    }
+
+    // Collective: every rank must call it once per generation
+    void update() {
+        moveAgents();
+        migrateAgents();
+        startHalo();
+        resolveInterior();
+        finishExchange(halo);
+        resolveBoundary();
+        reduceTypeCounts();
+        generation++;
+    }
+
+    int getGeneration() const { return generation; }
+
+    // Counts over every rank
+    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
+        rocks = typeCounts[static_cast<int>(ObjectType::ROCK)];
+        papers = typeCounts[static_cast<int>(ObjectType::PAPER)];
+        scissors = typeCounts[static_cast<int>(ObjectType::SCISSORS)];
+    }
+
+    int getTypeCount(int type) const { return typeCounts[type]; }
+
+    uint64_t getAgentCount() const {
+        uint64_t total = 0;
+        for (int t = 0; t < typeCount; t++) total += typeCounts[t];
+        return total;
+    }
+
+    bool isGameOver() const {
+        int nonZeroCount = 0;
+        for (int t = 0; t < typeCount; t++) nonZeroCount += typeCounts[t] > 0;
+        return nonZeroCount <= 1;
+    }
+
+    bool isDecided() const {
+        ObjectType winner;
+        return GameRules::decidedWinner(typeCounts, winner);
+    }
+
+    ObjectType getWinner() const {
+        ObjectType winner;
+        if (GameRules::decidedWinner(typeCounts, winner)) return winner;
+        return ObjectType::ROCK; // Fallback
+    }
+
+    // This rank's agents and their global indices
+    const AgentStore& getLocalAgents() const { return agents; }
+    const std::vector<uint64_t>& getLocalIds() const { return ids; }
+
+    int getRank() const { return rank; }
+    int getRankCount() const { return rankCount; }
+    uint64_t getSeed() const { return seed; }
+    float getBoxWidth() const { return boxWidth; }
+    float getBoxHeight() const { return boxHeight; }
+};
+
+using DistributedRPSSimulator = BasicDistributedSimulator<ClassicRules>;
+using DistributedLizardSpockSimulator = BasicDistributedSimulator<LizardSpockRules>;
+
+#endif //RPS_MPI_H
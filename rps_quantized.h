@@ -0,0 +1,327 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_QUANTIZED_H
+#define RPS_QUANTIZED_H
+
+#include "rps_simulator.h"
+
+// Fixed-point engine for very large runs and for comparing results across
+// machines. Positions are 16-bit steps on a grid over the box's longer side,
+// velocities are 8-bit steps of the spawn speed, and types are packed four
+// to a byte (two under rule sets with more than four types), about 6.25
+// bytes per agent against 24 for a GameObject. Every step after setup is
+// integer arithmetic with a fixed pair order, so a run gives bit-identical
+// results on every platform; compare checksum() values to confirm it.
+//
+// Resolution follows the float engine: pairs closer than the contact
+// distance convert by the rule set and are pushed apart by the separation
+// force. Candidates come from a grid built once per generation, with cells
+// wide enough for one push of slack, and agents are not re-binned as they
+// are nudged. The grid over the longer side must leave the agent radius
+// at least one step wide. Only uniform spawning is supported; runs match
+// float runs in distribution, not agent for agent.
+template <typename RuleSet>
+class BasicQuantizedSimulator {
+public:
+    static constexpr int typeCount = RuleSet::typeCount;
+    static constexpr int typesPerByte = typeCount <= 4 ? 4 : 2;
+    static constexpr int typeBits = 8 / typesPerByte;
+    static constexpr int32_t positionSteps = 65535;     // Steps across the longer side of the box
+    static constexpr int velocitySteps = 127;           // Steps from rest to the spawn speed
+
+private:
+    using GameRules = BasicGameRules<RuleSet>;
+
+    float boxWidth, boxHeight;
+    uint64_t seed;
+    float unit;                      // World size of one position step
+    float speed;                     // World speed of velocitySteps
+    int32_t extentX, extentY;        // Box size in position steps
+    int32_t radius, contact, separation;
+    int32_t displacement[256];       // Position steps per generation for each velocity + 128
+
+    std::vector<uint16_t> x, y;
+    std::vector<int8_t> vx, vy;
+    std::vector<uint8_t> types;      // typesPerByte per byte, lowest bits first
+    size_t count = 0;
+    int generation = 0;
+    int typeCounts[typeCount] = {};
+
+    // Broad phase, rebuilt every generation
+    int32_t cellSize = 1;
+    int cols = 1, rows = 1;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellItems;
+
+    mutable AgentStore floatAgents;  // Last conversion for getAgents
+    mutable bool floatCurrent = false;
+
+    uint8_t typeOf(size_t i) const {
+        return static_cast<uint8_t>((types[i / typesPerByte] >> (i % typesPerByte * typeBits)) &
+                                    ((1u << typeBits) - 1));
+    }
+
+    void setType(size_t i, uint8_t t) {
+        unsigned shift = i % typesPerByte * typeBits;
+        uint8_t& packed = types[i / typesPerByte];
+        packed = static_cast<uint8_t>((packed & ~(((1u << typeBits) - 1) << shift)) | (t << shift));
+    }
+
+    // Largest s with s * s <= v. The double square root is correctly
+    // rounded under IEEE 754, and the fix-up makes the result exact.
+    static uint32_t isqrt(uint64_t v) {
+        uint64_t s = static_cast<uint64_t>(std::sqrt(static_cast<double>(v)));
+        while (s * s > v) s--;
+        while ((s + 1) * (s + 1) <= v) s++;
+        return static_cast<uint32_t>(s);
+    }
+
+    int cellCoord(int32_t v, int count) const { return std::min(count - 1, static_cast<int>(v / cellSize)); }
+
+    void move() {
+        for (size_t i = 0; i < count; i++) {
+            int32_t px = x[i] + displacement[vx[i] + 128];
+            int32_t py = y[i] + displacement[vy[i] + 128];
+            if (px - radius <= 0 || px + radius >= extentX) {
+                vx[i] = static_cast<int8_t>(-vx[i]);
+                px = std::max(radius, std::min(extentX - radius, px));
+            }
+            if (py - radius <= 0 || py + radius >= extentY) {
+                vy[i] = static_cast<int8_t>(-vy[i]);
+                py = std::max(radius, std::min(extentY - radius, py));
+            }
+            x[i] = static_cast<uint16_t>(px);
+            y[i] = static_cast<uint16_t>(py);
+        }
+    }
+
+    void buildGrid() {
+        size_t cellCount = static_cast<size_t>(cols) * rows;
+        cellStart.assign(cellCount + 1, 0);
+        cellItems.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            cellStart[cellCoord(y[i], rows) * cols + cellCoord(x[i], cols) + 1]++;
+        }
+        for (size_t c = 0; c < cellCount; c++) cellStart[c + 1] += cellStart[c];
+        // Scatter from the back so each cell fills down to its start in
+        // ascending order, then shift the starts back into place
+        for (size_t i = count; i-- > 0;) {
+            size_t cell = static_cast<size_t>(cellCoord(y[i], rows)) * cols + cellCoord(x[i], cols);
+            cellItems[--cellStart[cell + 1]] = static_cast<uint32_t>(i);
+        }
+        for (size_t c = 0; c < cellCount; c++) cellStart[c] = cellStart[c + 1];
+        cellStart[cellCount] = static_cast<uint32_t>(count);
+    }
+
+    void resolve(uint32_t i, uint32_t j) {
+        int64_t dx = static_cast<int32_t>(x[i]) - x[j];
+        int64_t dy = static_cast<int32_t>(y[i]) - y[j];
+        uint64_t distanceSq = static_cast<uint64_t>(dx * dx + dy * dy);
+        if (distanceSq >= static_cast<uint64_t>(contact) * contact) return;
+
+        uint8_t t1 = typeOf(i), t2 = typeOf(j);
+        uint8_t winner = RuleSet::winner(t1, t2);
+        if (t1 != t2) {
+            typeCounts[t1 == winner ? t2 : t1]--;
+            typeCounts[winner]++;
+            setType(i, winner);
+            setType(j, winner);
+        }
+
+        int64_t distance = isqrt(distanceSq);
+        if (distance == 0) return;
+        int32_t pushX = static_cast<int32_t>(dx * separation / distance);
+        int32_t pushY = static_cast<int32_t>(dy * separation / distance);
+        auto nudge = [](uint16_t& p, int32_t by, int32_t extent) {
+            p = static_cast<uint16_t>(std::max(0, std::min(extent, p + by)));
+        };
+        nudge(x[i], pushX, extentX);
+        nudge(y[i], pushY, extentY);
+        nudge(x[j], -pushX, extentX);
+        nudge(y[j], -pushY, extentY);
+    }
+
+    // Every pair in ascending i, then in grid order of j > i
+    void resolveCollisions() {
+        buildGrid();
+        for (uint32_t i = 0; i < count; i++) {
+            int cx = cellCoord(x[i], cols), cy = cellCoord(y[i], rows);
+            for (int ny = std::max(0, cy - 1); ny <= std::min(rows - 1, cy + 1); ny++) {
+                for (int nx = std::max(0, cx - 1); nx <= std::min(cols - 1, cx + 1); nx++) {
+                    size_t cell = static_cast<size_t>(ny) * cols + nx;
+                    for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                        uint32_t j = cellItems[k];
+                        if (j > i) resolve(i, j);
+                    }
+                }
+            }
+        }
+    }
+
+    // Uniform in [lo, hi] from the top 32 bits of a draw
+    static int32_t spread(uint64_t bits, int32_t lo, int32_t hi) {
+        return lo + static_cast<int32_t>(((bits >> 32) * static_cast<uint64_t>(hi - lo + 1)) >> 32);
+    }
+
+public:
+    // Throws std::runtime_error if the parameters don't fit the fixed-point
+    // grid or ask for something only the float engine supports
+    BasicQuantizedSimulator(const SimulationParams& params, uint64_t seed)
+        : boxWidth(params.boxWidth), boxHeight(params.boxHeight), seed(seed) {
+        if (params.spawn.layout != SpawnLayout::UNIFORM || params.spawn.velocity != VelocityDistribution::UNIFORM) {
+            throw std::runtime_error("the quantized engine only spawns uniformly");
+        }
+        if (params.sweptCollisions || params.inertSleeping) {
+            throw std::runtime_error("the quantized engine has no swept collisions or sleeping");
+        }
+        unit = std::max(boxWidth, boxHeight) / positionSteps;
+        speed = params.spawn.speed;
+        extentX = static_cast<int32_t>(std::lround(boxWidth / unit));
+        extentY = static_cast<int32_t>(std::lround(boxHeight / unit));
+        radius = static_cast<int32_t>(std::lround(AgentStore::defaultRadius / unit));
+        separation = static_cast<int32_t>(std::lround(GameRules::separationForce / unit));
+        contact = 2 * radius;
+        if (radius < 1) throw std::runtime_error("the box is too large for the agents' radius at 16-bit positions");
+        for (int v = -128; v < 128; v++) {
+            displacement[v + 128] = static_cast<int32_t>(
+                std::lround(static_cast<double>(v) * speed / velocitySteps * params.timestep / unit));
+        }
+
+        std::vector<int> counts = {params.rocks, params.papers, params.scissors};
+        counts.insert(counts.end(), params.extraTypes.begin(), params.extraTypes.end());
+        counts.resize(typeCount, 0);
+        for (int t = 0; t < typeCount; t++) count += static_cast<size_t>(std::max(0, counts[t]));
+        if (count > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("the quantized engine holds at most 2^32 - 1 agents");
+        }
+        // Cells cover the contact distance plus one push, capped at four per agent
+        size_t maxCells = std::max<size_t>(64, 4 * count);
+        cellSize = contact + 2 * separation;
+        do {
+            cols = std::max(1, static_cast<int>((extentX + cellSize) / cellSize));
+            rows = std::max(1, static_cast<int>((extentY + cellSize) / cellSize));
+            if (static_cast<size_t>(cols) * rows <= maxCells) break;
+            cellSize *= 2;
+        } while (true);
+
+        // Types are dealt round-robin over those with agents left to place
+        x.resize(count);
+        y.resize(count);
+        vx.resize(count);
+        vy.resize(count);
+        types.assign((count + typesPerByte - 1) / typesPerByte, 0);
+        CounterRng rng(seed);
+        int left[typeCount];
+        for (int t = 0; t < typeCount; t++) left[t] = std::max(0, counts[t]);
+        int t = 0;
+        for (size_t i = 0; i < count; i++) {
+            while (left[t] == 0) t = (t + 1) % typeCount;
+            left[t]--;
+            setType(i, static_cast<uint8_t>(t));
+            typeCounts[t]++;
+            t = (t + 1) % typeCount;
+
+            uint64_t key = rng.streamKey(i);
+            x[i] = static_cast<uint16_t>(spread(CounterRng::keyedBits(key, 0), radius, extentX - radius));
+            y[i] = static_cast<uint16_t>(spread(CounterRng::keyedBits(key, 1), radius, extentY - radius));
+            vx[i] = static_cast<int8_t>(spread(CounterRng::keyedBits(key, 2), -velocitySteps, velocitySteps));
+            vy[i] = static_cast<int8_t>(spread(CounterRng::keyedBits(key, 3), -velocitySteps, velocitySteps));
+        }
+    }
+
+    void update() {
+        move();
+        resolveCollisions();
+        generation++;
+        floatCurrent = false;
+    }
+
+    int getGeneration() const { return generation; }
+
+    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
+        rocks = typeCounts[static_cast<int>(ObjectType::ROCK)];
+        papers = typeCounts[static_cast<int>(ObjectType::PAPER)];
+        scissors = typeCounts[static_cast<int>(ObjectType::SCISSORS)];
+    }
+
+    int getTypeCount(int type) const { return typeCounts[type]; }
+
+    bool isGameOver() const {
+        int nonZeroCount = 0;
+        for (int t = 0; t < typeCount; t++) nonZeroCount += typeCounts[t] > 0;
+        return nonZeroCount <= 1;
+    }
+
+    bool isDecided() const {
+        ObjectType winner;
+        return GameRules::decidedWinner(typeCounts, winner);
+    }
+
+    ObjectType getWinner() const {
+        ObjectType winner;
+        if (GameRules::decidedWinner(typeCounts, winner)) return winner;
+        return ObjectType::ROCK; // Fallback
+    }
+
+    // Agent state scaled back to world units, converted on demand and
+    // cached until the next step
+    const AgentStore& getAgents() const {
+        if (!floatCurrent) {
+            floatAgents.resize(count);
+            const float velocityUnit = speed / velocitySteps;
+            for (size_t i = 0; i < count; i++) {
+                floatAgents.x[i] = x[i] * unit;
+                floatAgents.y[i] = y[i] * unit;
+                floatAgents.vx[i] = vx[i] * velocityUnit;
+                floatAgents.vy[i] = vy[i] * velocityUnit;
+                floatAgents.type[i] = typeOf(i);
+            }
+            floatCurrent = true;
+        }
+        return floatAgents;
+    }
+
+    size_t getAgentCount() const { return count; }
+
+    // Bytes of agent state, excluding the broad-phase grid
+    size_t stateBytes() const {
+        return count * (2 * sizeof(uint16_t) + 2 * sizeof(int8_t)) + types.size();
+    }
+
+    // FNV-1a over the generation and every agent array. Equal on every
+    // platform for the same params and seed.
+    uint64_t checksum() const {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&](const void* data, size_t bytes) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            for (size_t b = 0; b < bytes; b++) hash = (hash ^ p[b]) * 0x100000001b3ULL;
+        };
+        // Hash values byte by byte in little-endian order so byte order can't differ
+        auto mixWords = [&](const std::vector<uint16_t>& words) {
+            for (uint16_t w : words) {
+                unsigned char bytes[2] = {static_cast<unsigned char>(w), static_cast<unsigned char>(w >> 8)};
+                mix(bytes, 2);
+            }
+        };
+        unsigned char g[4] = {static_cast<unsigned char>(generation), static_cast<unsigned char>(generation >> 8),
+                              static_cast<unsigned char>(generation >> 16), static_cast<unsigned char>(generation >> 24)};
+        mix(g, sizeof(g));
+        mixWords(x);
+        mixWords(y);
+        mix(vx.data(), vx.size());
+        mix(vy.data(), vy.size());
+        mix(types.data(), types.size());
+        return hash;
+    }
+
+    uint64_t getSeed() const { return seed; }
+    float getBoxWidth() const { return boxWidth; }
+    float getBoxHeight() const { return boxHeight; }
+};
+
+using QuantizedRPSSimulator = BasicQuantizedSimulator<ClassicRules>;
+using QuantizedLizardSpockSimulator = BasicQuantizedSimulator<LizardSpockRules>;
+
+#endif //RPS_QUANTIZED_H
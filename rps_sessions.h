@@ -0,0 +1,253 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_SESSIONS_H
+#define RPS_SESSIONS_H
+
+#include "rps_simulator.h"
+
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+#error "rps_sessions.h needs C++20 coroutines; build with -DRPS_ENABLE_SESSIONS=ON"
+#endif
+
+#include <coroutine>    // For suspending sessions between frames
+#include <exception>    // For passing a session's failure to wait()
+#include <utility>      // For std::as_const
+
+// Cooperative scheduling for many small live simulations, such as one per
+// user of an interactive service. Each session is a coroutine that steps
+// its simulator for one frame and then suspends until its next frame is
+// due, so a suspended session costs its coroutine frame and its simulator
+// but no thread. SessionScheduler resumes sessions on a small pool of
+// workers in deadline order.
+
+using SessionClock = std::chrono::steady_clock;
+
+class SessionScheduler;
+
+// Coroutine type of a session. A session starts suspended and runs once
+// it is handed to SessionScheduler::spawn, which then owns it.
+class SessionTask {
+public:
+    struct promise_type {
+        SessionScheduler* scheduler = nullptr;
+        std::exception_ptr error;
+
+        // Hands the session back to its scheduler, which frees it
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+            void await_resume() const noexcept {}
+        };
+
+        SessionTask get_return_object() {
+            return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_void() const {}
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    SessionTask(SessionTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    SessionTask(const SessionTask&) = delete;
+    SessionTask& operator=(const SessionTask&) = delete;
+    ~SessionTask() {
+        if (handle) handle.destroy();
+    }
+
+private:
+    friend class SessionScheduler;
+    explicit SessionTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Runs sessions on `threads` workers (0 picks one per hardware thread).
+// A session only ever runs on one worker at a time, and everything it did
+// in one frame is visible to whichever worker resumes it for the next, so
+// its simulator needs no locking of its own.
+class SessionScheduler {
+public:
+    explicit SessionScheduler(unsigned threads = 1) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        workers.reserve(threads);
+        for (unsigned t = 0; t < threads; t++) workers.emplace_back(&SessionScheduler::workerLoop, this);
+    }
+
+    SessionScheduler(const SessionScheduler&) = delete;
+    SessionScheduler& operator=(const SessionScheduler&) = delete;
+
+    // Stops the workers and frees any session that has not finished
+    ~SessionScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (std::thread& worker : workers) worker.join();
+        for (Entry& entry : queue) entry.session.destroy();
+    }
+
+    // Start a session; its first frame runs as soon as a worker is free
+    void spawn(SessionTask task) {
+        auto handle = std::exchange(task.handle, nullptr);
+        handle.promise().scheduler = this;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            live++;
+        }
+        resumeAt(handle, SessionClock::now());
+    }
+
+    // Block until every spawned session has finished, then rethrow the
+    // first exception a session let escape, if any
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return live == 0; });
+        if (error) std::rethrow_exception(std::exchange(error, nullptr));
+    }
+
+    size_t getLiveSessionCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return live;
+    }
+
+    unsigned getThreadCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // co_await scheduler.until(deadline) suspends the calling session and
+    // frees its worker until deadline has passed
+    struct DeadlineAwaiter {
+        SessionScheduler& scheduler;
+        SessionClock::time_point deadline;
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> session) { scheduler.resumeAt(session, deadline); }
+        void await_resume() const {}
+    };
+
+    DeadlineAwaiter until(SessionClock::time_point deadline) { return DeadlineAwaiter{*this, deadline}; }
+
+private:
+    // Min-heap entry; order breaks deadline ties first come, first served
+    struct Entry {
+        SessionClock::time_point deadline;
+        uint64_t order;
+        std::coroutine_handle<> session;
+
+        bool operator>(const Entry& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : order > other.order;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    mutable std::mutex mutex;
+    std::condition_variable ready;      // Workers: a new earliest deadline, or stopping
+    std::condition_variable finished;   // wait(): the last session finished
+    std::vector<Entry> queue;
+    uint64_t nextOrder = 0;
+    size_t live = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    friend struct SessionTask::promise_type::FinalAwaiter;
+
+    void resumeAt(std::coroutine_handle<> session, SessionClock::time_point deadline) {
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(Entry{deadline, nextOrder++, session});
+            std::push_heap(queue.begin(), queue.end(), std::greater<Entry>());
+            earliest = queue.front().session == session;
+        }
+        // A worker sleeping towards a later deadline has to look again
+        if (earliest) ready.notify_one();
+    }
+
+    void retire(std::exception_ptr sessionError) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sessionError && !error) error = std::move(sessionError);
+        if (--live == 0) finished.notify_all();
+    }
+
+    void workerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            if (queue.empty()) {
+                ready.wait(lock);
+                continue;
+            }
+            SessionClock::time_point now = SessionClock::now();
+            if (now < queue.front().deadline) {
+                ready.wait_until(lock, queue.front().deadline);
+                continue;
+            }
+            std::pop_heap(queue.begin(), queue.end(), std::greater<Entry>());
+            std::coroutine_handle<> session = queue.back().session;
+            queue.pop_back();
+            // Another session may be due already; let an idle worker take it
+            bool more = !queue.empty() && queue.front().deadline <= now;
+            lock.unlock();
+            if (more) ready.notify_one();
+            session.resume();
+            lock.lock();
+        }
+    }
+};
+
+inline void SessionTask::promise_type::FinalAwaiter::await_suspend(
+        std::coroutine_handle<promise_type> handle) noexcept {
+    SessionScheduler* scheduler = handle.promise().scheduler;
+    std::exception_ptr error = std::move(handle.promise().error);
+    handle.destroy();
+    scheduler->retire(std::move(error));
+}
+
+// How a live session is paced
+struct SessionPacing {
+    double fps = 30.0;
+    int generationsPerFrame = 1;    // Generations stepped before the session yields
+    int maxGenerations = 1000;
+    bool untilDecided = false;      // Stop once the winner is certain rather than at extinction
+};
+
+// What a session's frame callback learns about the frame it just ran
+struct FrameTiming {
+    uint64_t frame = 0;
+    double lateness = 0.0;          // Seconds between the frame's deadline and its start
+    bool skipped = false;           // Frames were dropped before this one to catch up
+};
+
+// Play simulator as a live session: each frame steps
+// pacing.generationsPerFrame generations, calls
+// onFrame(const Simulator&, const FrameTiming&), and suspends until the
+// next frame is due. The session ends when the game does, at
+// pacing.maxGenerations, or when onFrame returns false. Frames are paced
+// by deadline, one interval after the last, so a late frame does not
+// push back the ones after it; a session more than a frame behind starts
+// again from now rather than running its missed frames back to back.
+// The scheduler and the simulator must outlive the session.
+template <typename Simulator, typename OnFrame>
+SessionTask liveSession(SessionScheduler& scheduler, Simulator& simulator, SessionPacing pacing, OnFrame onFrame) {
+    auto interval = std::chrono::duration_cast<SessionClock::duration>(std::chrono::duration<double>(1.0 / pacing.fps));
+    auto running = [&] {
+        return simulator.getGeneration() < pacing.maxGenerations &&
+               !(pacing.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    SessionClock::time_point deadline = SessionClock::now();
+    FrameTiming timing;
+    while (running()) {
+        SessionClock::time_point start = SessionClock::now();
+        timing.lateness = std::chrono::duration<double>(start - deadline).count();
+        for (int g = 0; g < pacing.generationsPerFrame && running(); g++) simulator.update();
+        if (!onFrame(std::as_const(simulator), std::as_const(timing))) co_return;
+        timing.frame++;
+        deadline += interval;
+        SessionClock::time_point end = SessionClock::now();
+        timing.skipped = deadline + interval < end;
+        if (timing.skipped) deadline = end;
+        co_await scheduler.until(deadline);
+    }
+}
+
+#endif //RPS_SESSIONS_H
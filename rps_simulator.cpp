@@ -2,273 +2,862 @@
 // Created by Harshwardhan Singh on 17/07/25.
 //
 
+#include "rps_simulator.h"
+#include "rps_quantized.h"
+#ifdef RPS_ENABLE_CUDA
+#include "rps_cuda.h"
+#endif
+#ifdef RPS_ENABLE_MPI
+#include "rps_mpi.h"
+#endif
+#ifdef RPS_ENABLE_SESSIONS
+#include "rps_sessions.h"
+#endif
+
 #include <iostream>      // For console output
-#include <vector>        // For storing game objects
-#include <random>        // For random number generation
-#include <cmath>         // For mathematical operations (distance, etc.)
-#include <chrono>        // For timing and seeding random generator
+#include <chrono>        // For timing runs and seeding
 #include <thread>        // For adding delays in simulation
 #include <iomanip>       // For formatted output
-
-
-enum class ObjectType {
-    ROCK,
-    PAPER,
-    SCISSORS
+#include <string>        // For command-line flags
+#include <stdexcept>     // For reporting bad command-line values
+
+// Settings taken from the command line
+struct CommandLineOptions {
+    SimulationParams params;
+    uint64_t seed = 0;
+    bool seedGiven = false;
+    unsigned threads = 1;
+    bool headless = false;
+    bool ensemble = false;
+    bool untilDecided = false;
+    bool gpu = false;
+    bool quantized = false;
+    bool distributed = false;
+    bool reorder = false;
+    int ruleTypes = 3;              // ClassicRules, or 5 for LizardSpockRules
+    long long agents = -1;          // Split across the rule set's types once all flags are read
+    uint64_t ensembleSeeds = 1000;
+    int sessions = 0;               // Live sessions to multiplex, none unless given
+    int sessionStep = 1;
+    int viewCols = 40;
+    int viewRows = 20;
+    bool redraw = false;
+    double fps = 0;
+    std::string recordPath;
+    std::string eventsPath;
+    std::string checkpointPath;
+    std::string profilePath;
+    std::string statsPath;
+    int statsEvery = 100;
+    int metricsPort = -1;           // No metrics endpoint unless given
+    int checkpointEvery = 1000;
+    std::string resumePath;
+    std::string replayPath;
+    long long replayFrame = -1;     // Last frame unless given
 };
 
-// Convert enum to string for display
-std::string typeToString(ObjectType type) {
-    switch(type) {
-        case ObjectType::ROCK: return "Rock";
-        case ObjectType::PAPER: return "Paper";
-        case ObjectType::SCISSORS: return "Scissors";
-    }
-    return "Unknown";
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --headless          Run without rendering or delays and report throughput\n"
+              << "  --agents N          Total agents, split evenly across the types (default 15)\n"
+              << "  --rules rps|rpsls   Rock-Paper-Scissors, or with Spock and Lizard (headless only; default rps)\n"
+              << "  --spawn LAYOUT[:N]  Start uniform, clustered or in stripes, with N clusters or stripes\n"
+              << "                      per type (default uniform)\n"
+              << "  --velocity V[:S]    uniform (each component in [-S, S]) or fixed (speed S), S default 2\n"
+              << "  --box W[xH]         Box size (default 100x100)\n"
+              << "  --generations N     Generation cap (default 1000)\n"
+              << "  --timestep DT       Fraction of its velocity an agent moves per generation (default 1)\n"
+              << "  --swept             Detect contacts along each move so large timesteps miss none\n"
+              << "  --sleep             Skip collisions in neighbourhoods that hold a single type\n"
+              << "  --reorder           Keep agents sorted along a Morton curve for cache locality\n"
+              << "  --seed N            Random seed (default: time-based)\n"
+              << "  --threads N         Simulation threads, 0 = all cores (default 1)\n"
+              << "  --gpu               With --headless, step on the CUDA backend (builds with -DRPS_ENABLE_CUDA=ON)\n"
+              << "  --quantized         With --headless, step the fixed-point engine and print a checksum\n"
+              << "                      that matches on every platform\n"
+              << "  --distributed       With --headless under mpirun, split the box across MPI ranks\n"
+              << "                      (builds with -DRPS_ENABLE_MPI=ON)\n"
+              << "  --ensemble [SEEDS]  Sweep starting mixes over SEEDS seeds (default 1000)\n"
+              << "  --until-decided     Stop once only two types remain and the winner is certain\n"
+              << "  --sessions N        With --headless, play N seeds as live sessions paced at --fps (default 30),\n"
+              << "                      all on the --threads workers (builds with -DRPS_ENABLE_SESSIONS=ON)\n"
+              << "  --session-step N    Generations each session steps per frame (default 1)\n"
+              << "  --view COLSxROWS    Display resolution in characters (default 40x20)\n"
+              << "  --redraw            Redraw the display in place instead of scrolling\n"
+              << "  --fps N             Draw on a separate thread at N frames/s and run without pauses\n"
+              << "  --profile FILE      With --headless, time each update() phase and write a Chrome trace\n"
+              << "                      (builds with -DRPS_ENABLE_PROFILING=ON)\n"
+              << "  --stats FILE        With --headless, write population samples as CSV (- for stdout)\n"
+              << "  --stats-every N     Generations between samples (default 100)\n"
+              << "  --metrics-port P    With --headless, serve the latest sample as Prometheus metrics\n"
+              << "                      at http://127.0.0.1:P/metrics\n"
+              << "  --record FILE       With --headless, write every generation to a trajectory file\n"
+              << "  --events FILE       With --headless, log every conversion as binary records (- for CSV on stdout)\n"
+              << "  --checkpoint FILE   With --headless, save a checkpoint to FILE every --checkpoint-every generations\n"
+              << "  --checkpoint-every N  Generations between checkpoints (default 1000)\n"
+              << "  --resume FILE       With --headless, continue from a checkpoint\n"
+              << "  --replay FILE       Summarize a trajectory file instead of simulating\n"
+              << "  --frame N           Frame of the trajectory to summarize (default: last)\n"
+              << "  --help              Show this message\n";
 }
 
-// Convert enum to symbol for compact display
-char typeToSymbol(ObjectType type) {
-    switch(type) {
-        case ObjectType::ROCK: return 'R';
-        case ObjectType::PAPER: return 'P';
-        case ObjectType::SCISSORS: return 'S';
+// Returns false and prints a message if the arguments are invalid
+static bool parseCommandLine(int argc, char** argv, CommandLineOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> const char* {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--headless") {
+                options.headless = true;
+            } else if (arg == "--agents") {
+                options.agents = std::stoll(value());
+                if (options.agents < 0) throw std::invalid_argument("--agents must not be negative");
+            } else if (arg == "--rules") {
+                std::string rules = value();
+                if (rules == "rps") {
+                    options.ruleTypes = 3;
+                } else if (rules == "rpsls") {
+                    options.ruleTypes = 5;
+                } else {
+                    throw std::invalid_argument("--rules must be rps or rpsls");
+                }
+            } else if (arg == "--spawn") {
+                std::string spawn = value();
+                size_t split = spawn.find(':');
+                std::string layout = spawn.substr(0, split);
+                if (layout == "uniform") {
+                    options.params.spawn.layout = SpawnLayout::UNIFORM;
+                } else if (layout == "clustered") {
+                    options.params.spawn.layout = SpawnLayout::CLUSTERED;
+                } else if (layout == "stripes") {
+                    options.params.spawn.layout = SpawnLayout::STRIPES;
+                } else {
+                    throw std::invalid_argument("--spawn must be uniform, clustered or stripes");
+                }
+                if (split != std::string::npos) {
+                    options.params.spawn.groupsPerType = std::stoi(spawn.substr(split + 1));
+                    if (options.params.spawn.groupsPerType <= 0) {
+                        throw std::invalid_argument("--spawn needs at least one group per type");
+                    }
+                }
+            } else if (arg == "--velocity") {
+                std::string velocity = value();
+                size_t split = velocity.find(':');
+                std::string distribution = velocity.substr(0, split);
+                if (distribution == "uniform") {
+                    options.params.spawn.velocity = VelocityDistribution::UNIFORM;
+                } else if (distribution == "fixed") {
+                    options.params.spawn.velocity = VelocityDistribution::FIXED_SPEED;
+                } else {
+                    throw std::invalid_argument("--velocity must be uniform or fixed");
+                }
+                if (split != std::string::npos) {
+                    options.params.spawn.speed = std::stof(velocity.substr(split + 1));
+                    if (!(options.params.spawn.speed >= 0)) {
+                        throw std::invalid_argument("--velocity speed must not be negative");
+                    }
+                }
+            } else if (arg == "--box") {
+                std::string box = value();
+                size_t split = box.find('x');
+                options.params.boxWidth = std::stof(box.substr(0, split));
+                options.params.boxHeight = split == std::string::npos
+                    ? options.params.boxWidth : std::stof(box.substr(split + 1));
+                if (options.params.boxWidth <= 20 || options.params.boxHeight <= 20) {
+                    throw std::invalid_argument("--box must be larger than 20x20");
+                }
+            } else if (arg == "--generations") {
+                options.params.maxGenerations = std::stoi(value());
+            } else if (arg == "--timestep") {
+                options.params.timestep = std::stof(value());
+                if (!(options.params.timestep > 0)) throw std::invalid_argument("--timestep must be positive");
+            } else if (arg == "--swept") {
+                options.params.sweptCollisions = true;
+            } else if (arg == "--sleep") {
+                options.params.inertSleeping = true;
+            } else if (arg == "--reorder") {
+                options.reorder = true;
+            } else if (arg == "--seed") {
+                options.seed = std::stoull(value());
+                options.seedGiven = true;
+            } else if (arg == "--threads") {
+                options.threads = static_cast<unsigned>(std::stoul(value()));
+            } else if (arg == "--gpu") {
+                options.gpu = true;
+            } else if (arg == "--quantized") {
+                options.quantized = true;
+            } else if (arg == "--distributed") {
+                options.distributed = true;
+            } else if (arg == "--ensemble") {
+                options.ensemble = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-') options.ensembleSeeds = std::stoull(value());
+            } else if (arg == "--until-decided") {
+                options.untilDecided = true;
+            } else if (arg == "--sessions") {
+                options.sessions = std::stoi(value());
+                if (options.sessions <= 0) throw std::invalid_argument("--sessions must be positive");
+            } else if (arg == "--session-step") {
+                options.sessionStep = std::stoi(value());
+                if (options.sessionStep <= 0) throw std::invalid_argument("--session-step must be positive");
+            } else if (arg == "--view") {
+                std::string view = value();
+                size_t split = view.find('x');
+                if (split == std::string::npos) throw std::invalid_argument("--view needs COLSxROWS");
+                options.viewCols = std::stoi(view.substr(0, split));
+                options.viewRows = std::stoi(view.substr(split + 1));
+                if (options.viewCols <= 0 || options.viewRows <= 0) {
+                    throw std::invalid_argument("--view must be at least 1x1");
+                }
+            } else if (arg == "--redraw") {
+                options.redraw = true;
+            } else if (arg == "--fps") {
+                options.fps = std::stod(value());
+                if (options.fps <= 0) throw std::invalid_argument("--fps must be positive");
+            } else if (arg == "--profile") {
+                options.profilePath = value();
+            } else if (arg == "--stats") {
+                options.statsPath = value();
+            } else if (arg == "--stats-every") {
+                options.statsEvery = std::stoi(value());
+                if (options.statsEvery <= 0) throw std::invalid_argument("--stats-every must be positive");
+            } else if (arg == "--metrics-port") {
+                options.metricsPort = std::stoi(value());
+                if (options.metricsPort < 0 || options.metricsPort > 65535) {
+                    throw std::invalid_argument("--metrics-port must be between 0 and 65535");
+                }
+            } else if (arg == "--record") {
+                options.recordPath = value();
+            } else if (arg == "--events") {
+                options.eventsPath = value();
+            } else if (arg == "--checkpoint") {
+                options.checkpointPath = value();
+            } else if (arg == "--checkpoint-every") {
+                options.checkpointEvery = std::stoi(value());
+                if (options.checkpointEvery <= 0) throw std::invalid_argument("--checkpoint-every must be positive");
+            } else if (arg == "--resume") {
+                options.resumePath = value();
+            } else if (arg == "--replay") {
+                options.replayPath = value();
+            } else if (arg == "--frame") {
+                options.replayFrame = std::stoll(value());
+                if (options.replayFrame < 0) throw std::invalid_argument("--frame must not be negative");
+            } else if (arg == "--help") {
+                printUsage(argv[0]);
+                return false;
+            } else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            printUsage(argv[0]);
+            return false;
+        }
     }
-    return '?';
-}
-
-class GameObject {
-public:
-    ObjectType type;
-    float x, y;           // Position
-    float vx, vy;         // Velocity
-    float radius;         // For collision detection
 
-    GameObject(ObjectType t, float startX, float startY)
-        : type(t), x(startX), y(startY), radius(5.0f) {
-        // Initialize with random velocity
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_real_distribution<float> velDist(-2.0f, 2.0f);
-
-        vx = velDist(gen);
-        vy = velDist(gen);
+    if (options.ruleTypes != 3 && (!options.headless || options.ensemble || !options.recordPath.empty())) {
+        std::cerr << "Error: --rules rpsls needs --headless and does not support --ensemble or --record\n";
+        printUsage(argv[0]);
+        return false;
     }
-
-    // Update position based on velocity
-    void update() {
-        x += vx;
-        y += vy;
+    if (options.gpu && (!options.headless || options.ruleTypes != 3 || options.params.sweptCollisions ||
+                        !options.recordPath.empty() || !options.eventsPath.empty() ||
+                        !options.checkpointPath.empty() || !options.resumePath.empty())) {
+        std::cerr << "Error: --gpu needs --headless and supports only the classic rules without "
+                     "--swept, --record, --events, --checkpoint or --resume\n";
+        printUsage(argv[0]);
+        return false;
     }
-
-    // Check collision with another object
-    bool collidesWith(const GameObject& other) const {
-        float dx = x - other.x;
-        float dy = y - other.y;
-        float distance = std::sqrt(dx * dx + dy * dy);
-        return distance < (radius + other.radius);
+    if (options.distributed && (!options.headless || options.gpu || options.params.sweptCollisions ||
+                                !options.recordPath.empty() || !options.eventsPath.empty() ||
+                                !options.checkpointPath.empty() || !options.resumePath.empty())) {
+        std::cerr << "Error: --distributed needs --headless and does not support --gpu, --swept, --record, "
+                     "--events, --checkpoint or --resume\n";
+        printUsage(argv[0]);
+        return false;
     }
-
-    // Handle boundary bouncing
-    void handleBoundaries(float width, float height) {
-        if (x - radius <= 0 || x + radius >= width) {
-            vx = -vx;
-            x = std::max(radius, std::min(width - radius, x));
+    if (options.quantized && (!options.headless || options.gpu || options.distributed || options.ensemble ||
+                              options.params.sweptCollisions || options.params.inertSleeping || options.reorder ||
+                              !options.recordPath.empty() || !options.eventsPath.empty() ||
+                              !options.checkpointPath.empty() || !options.resumePath.empty() ||
+                              !options.statsPath.empty() || options.metricsPort >= 0 || !options.profilePath.empty())) {
+        std::cerr << "Error: --quantized needs --headless and supports none of the other engine, output or "
+                     "checkpoint options\n";
+        printUsage(argv[0]);
+        return false;
+    }
+    if (options.sessions > 0 && (!options.headless || options.ensemble || options.gpu || options.quantized ||
+                                 options.distributed || !options.recordPath.empty() || !options.eventsPath.empty() ||
+                                 !options.checkpointPath.empty() || !options.resumePath.empty() ||
+                                 !options.statsPath.empty() || options.metricsPort >= 0 ||
+                                 !options.profilePath.empty())) {
+        std::cerr << "Error: --sessions needs --headless and does not support --ensemble, --gpu, --quantized, "
+                     "--distributed or the output and checkpoint options\n";
+        printUsage(argv[0]);
+        return false;
+    }
+    if (options.params.inertSleeping && (options.params.sweptCollisions || options.ensemble || options.gpu ||
+                                         options.distributed)) {
+        std::cerr << "Error: --sleep does not support --swept, --ensemble, --gpu or --distributed\n";
+        printUsage(argv[0]);
+        return false;
+    }
+    if (options.reorder && (options.ensemble || options.gpu || options.distributed)) {
+        std::cerr << "Error: --reorder does not support --ensemble, --gpu or --distributed\n";
+        printUsage(argv[0]);
+        return false;
+    }
+    if ((!options.statsPath.empty() || options.metricsPort >= 0) &&
+        (!options.headless || options.ensemble || options.gpu || options.distributed)) {
+        std::cerr << "Error: --stats and --metrics-port need --headless and do not support --ensemble, --gpu "
+                     "or --distributed\n";
+        printUsage(argv[0]);
+        return false;
+    }
+    if (!options.profilePath.empty()) {
+        const char* problem = nullptr;
+        if (!GenerationStats::enabled) {
+            problem = "--profile needs a build configured with -DRPS_ENABLE_PROFILING=ON";
+        } else if (!options.headless || options.ensemble || options.gpu || options.distributed) {
+            problem = "--profile needs --headless and does not support --ensemble, --gpu or --distributed";
         }
-        if (y - radius <= 0 || y + radius >= height) {
-            vy = -vy;
-            y = std::max(radius, std::min(height - radius, y));
+        if (problem) {
+            std::cerr << "Error: " << problem << "\n";
+            printUsage(argv[0]);
+            return false;
         }
     }
-};
-
-class GameRules {
-public:
-    // Determine winner between two object types
-    static ObjectType determineWinner(ObjectType type1, ObjectType type2) {
-        if (type1 == type2) return type1; // No change if same type
-
-        switch(type1) {
-            case ObjectType::ROCK:
-                return (type2 == ObjectType::SCISSORS) ? ObjectType::ROCK : ObjectType::PAPER;
-            case ObjectType::PAPER:
-                return (type2 == ObjectType::ROCK) ? ObjectType::PAPER : ObjectType::SCISSORS;
-            case ObjectType::SCISSORS:
-                return (type2 == ObjectType::PAPER) ? ObjectType::SCISSORS : ObjectType::ROCK;
-        }
-        return type1;
+    if (options.agents >= 0) {
+        // The first agents % types types get one extra agent each
+        int types = options.ruleTypes;
+        std::vector<int> counts(types);
+        for (int t = 0; t < types; t++) counts[t] = static_cast<int>(options.agents / types + (options.agents % types > t));
+        options.params.rocks = counts[0];
+        options.params.papers = counts[1];
+        options.params.scissors = counts[2];
+        options.params.extraTypes.assign(counts.begin() + 3, counts.end());
     }
 
-    // Apply collision result to two objects
-    static void resolveCollision(GameObject& obj1, GameObject& obj2) {
-        ObjectType winner = determineWinner(obj1.type, obj2.type);
-
-        // Both objects become the winning type
-        obj1.type = winner;
-        obj2.type = winner;
-
-        // Add some separation to prevent immediate re-collision
-        float dx = obj1.x - obj2.x;
-        float dy = obj1.y - obj2.y;
-        float distance = std::sqrt(dx * dx + dy * dy);
+    if (!options.seedGiven) {
+        options.seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    return true;
+}
 
-        if (distance > 0) {
-            float separationForce = 2.0f;
-            obj1.x += (dx / distance) * separationForce;
-            obj1.y += (dy / distance) * separationForce;
-            obj2.x -= (dx / distance) * separationForce;
-            obj2.y -= (dy / distance) * separationForce;
+// Step as fast as possible with no rendering and report throughput.
+// Simulator is RPSSimulator or another rule set's instance.
+template <typename Simulator>
+static int runHeadless(const CommandLineOptions& options) {
+    const SimulationParams& params = options.params;
+    SimulationParams startParams = params;
+    startParams.threads = options.threads;    // Fills the population on the pool too
+    if (!options.resumePath.empty()) {
+        startParams.rocks = startParams.papers = startParams.scissors = 0;
+        startParams.extraTypes.clear();
+    }
+    auto setupStart = std::chrono::steady_clock::now();
+    Simulator simulator(startParams, options.seed);
+    if (!options.resumePath.empty()) simulator.loadCheckpoint(options.resumePath);
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+    if (options.reorder) simulator.setSpatialReordering(true);   // A checkpoint restores its own setting
+    const uint64_t agentCount = simulator.getAgents().size();
+    const int firstGeneration = simulator.getGeneration();
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (!options.checkpointPath.empty()) checkpoints.reset(new CheckpointWriter());
+    // Trajectory files pack types in two bits, so only the classic game records
+    constexpr bool recordable = Simulator::typeCount == 3;
+    std::unique_ptr<TrajectoryWriter> recorder;
+    if constexpr (recordable) {
+        if (!options.recordPath.empty()) {
+            recorder.reset(new TrajectoryWriter(options.recordPath, simulator));
+            recorder->record(simulator);
         }
     }
-};
-
-class RPSSimulator {
-private:
-    std::vector<GameObject> objects;
-    float boxWidth, boxHeight;
-    std::mt19937 rng;
-    int generation;
-
-public:
-    RPSSimulator(float width, float height)
-        : boxWidth(width), boxHeight(height), generation(0) {
-        // Seed random number generator
-        rng.seed(std::chrono::steady_clock::now().time_since_epoch().count());
-
-        // Initialize objects
-        initializeObjects();
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> eventsFile(nullptr, std::fclose);
+    std::unique_ptr<ConversionLog> events;
+    if (options.eventsPath == "-") {
+        events.reset(new ConversionLog(ConversionLog::textSink(std::cout)));
+    } else if (!options.eventsPath.empty()) {
+        eventsFile.reset(std::fopen(options.eventsPath.c_str(), "wb"));
+        if (!eventsFile) throw std::runtime_error("cannot create event log " + options.eventsPath);
+        events.reset(new ConversionLog(ConversionLog::fileSink(eventsFile.get())));
     }
-
-    void initializeObjects() {
-        objects.clear();
-
-        std::uniform_real_distribution<float> xDist(10, boxWidth - 10);
-        std::uniform_real_distribution<float> yDist(10, boxHeight - 10);
-
-        // Create 5 of each type
-        for (int i = 0; i < 5; i++) {
-            objects.emplace_back(ObjectType::ROCK, xDist(rng), yDist(rng));
-            objects.emplace_back(ObjectType::PAPER, xDist(rng), yDist(rng));
-            objects.emplace_back(ObjectType::SCISSORS, xDist(rng), yDist(rng));
+    simulator.setConversionLog(events.get());
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> statsFile(nullptr, std::fclose);
+    std::unique_ptr<PrometheusExporter> metrics;
+    std::unique_ptr<StatsFeed> feed;
+    if (!options.statsPath.empty() || options.metricsPort >= 0) {
+        feed.reset(new StatsFeed(options.statsEvery));
+        if (options.statsPath == "-") {
+            feed->subscribe(StatsFeed::csvSink(stdout));
+        } else if (!options.statsPath.empty()) {
+            statsFile.reset(std::fopen(options.statsPath.c_str(), "w"));
+            if (!statsFile) throw std::runtime_error("cannot create stats file " + options.statsPath);
+            feed->subscribe(StatsFeed::csvSink(statsFile.get()));
+        }
+        if (options.metricsPort >= 0) {
+            metrics.reset(new PrometheusExporter(static_cast<uint16_t>(options.metricsPort)));
+            feed->subscribe(metrics->sink(), 1);
+            std::cout << "Metrics: http://127.0.0.1:" << metrics->getPort() << "/metrics" << std::endl;
         }
+        simulator.setStatsFeed(feed.get());
     }
-
-    void update() {
-        // Update all objects
-        for (auto& obj : objects) {
-            obj.update();
-            obj.handleBoundaries(boxWidth, boxHeight);
+    std::unique_ptr<ChromeTraceWriter> trace;
+    if (!options.profilePath.empty()) trace.reset(new ChromeTraceWriter(options.profilePath));
+    GenerationStats profile;    // Summed over the run
+
+    auto start = std::chrono::steady_clock::now();
+    auto running = [&] {
+        return !(options.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    while (simulator.getGeneration() < params.maxGenerations && running()) {
+        simulator.update();
+        if constexpr (recordable) {
+            if (recorder) recorder->record(simulator);
         }
-
-        // Check for collisions
-        for (size_t i = 0; i < objects.size(); i++) {
-            for (size_t j = i + 1; j < objects.size(); j++) {
-                if (objects[i].collidesWith(objects[j])) {
-                    GameRules::resolveCollision(objects[i], objects[j]);
-                }
-            }
+        if (trace) {
+            const GenerationStats& stats = simulator.getGenerationStats();
+            trace->record(stats);
+            for (int p = 0; p < GenerationStats::PHASE_COUNT; p++) profile.phaseSeconds[p] += stats.phaseSeconds[p];
+            profile.pairsTested += stats.pairsTested;
+            profile.pairsColliding += stats.pairsColliding;
+            profile.conversions += stats.conversions;
+        }
+        if (checkpoints && simulator.getGeneration() % options.checkpointEvery == 0) {
+            checkpoints->save(simulator, options.checkpointPath);
         }
-
-        generation++;
     }
-
-    // Count objects of each type
-    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
-        rocks = papers = scissors = 0;
-
-        for (const auto& obj : objects) {
-            switch(obj.type) {
-                case ObjectType::ROCK: rocks++; break;
-                case ObjectType::PAPER: papers++; break;
-                case ObjectType::SCISSORS: scissors++; break;
-            }
+    if (recorder) recorder->close();
+    if (events) events->flush();
+    if (feed) feed->flush();
+    if (checkpoints) checkpoints->wait();
+    if (trace) trace->close();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int rocks, papers, scissors;
+    simulator.getTypeCounts(rocks, papers, scissors);
+    int generations = simulator.getGeneration() - firstGeneration;
+    double perSecond = seconds > 0 ? generations / seconds : 0.0;
+
+    std::cout << "Agents: " << agentCount << " | Box: " << simulator.getBoxWidth() << "x"
+              << simulator.getBoxHeight() << " | Seed: " << simulator.getSeed()
+              << " | Threads: " << simulator.getThreadCount() << "\n";
+    if (firstGeneration > 0) std::cout << "Resumed at generation " << firstGeneration << "\n";
+    std::cout << "Setup: " << std::fixed << std::setprecision(1) << setupSeconds * 1000 << " ms\n";
+    std::cout << "Generations: " << generations << " in " << std::fixed << std::setprecision(3)
+              << seconds << " s\n";
+    std::cout << "Generations/second: " << std::setprecision(1) << perSecond << "\n";
+    std::cout << "Agent-updates/second: " << std::setprecision(0) << perSecond * agentCount << "\n";
+    if (simulator.hasInertSleeping()) {
+        std::cout << "Asleep: " << simulator.getSleepingAgentCount() << " agents in the last generation\n";
+    }
+    if (trace && generations > 0) {
+        double profiled = std::max(profile.totalSeconds(), 1e-12);
+        std::cout << "Phases:";
+        for (int p = 0; p < GenerationStats::PHASE_COUNT; p++) {
+            std::cout << (p ? " | " : " ") << GenerationStats::phaseName(p) << " " << std::setprecision(1)
+                      << 100.0 * profile.phaseSeconds[p] / profiled << "%";
         }
+        std::cout << "\nPairs per generation: tested " << std::setprecision(0)
+                  << static_cast<double>(profile.pairsTested) / generations << " | colliding "
+                  << static_cast<double>(profile.pairsColliding) / generations << " | conversions "
+                  << static_cast<double>(profile.conversions) / generations << "\n";
+        std::cout << "Trace: " << options.profilePath << "\n";
     }
-
-    // Check if game is over (only one type remains)
-    bool isGameOver() const {
-        int rocks, papers, scissors;
-        getTypeCounts(rocks, papers, scissors);
-
-        int nonZeroCount = (rocks > 0) + (papers > 0) + (scissors > 0);
-        return nonZeroCount <= 1;
+    std::cout << "Final: Rocks " << rocks << " | Papers " << papers << " | Scissors " << scissors;
+    for (int t = 3; t < Simulator::typeCount; t++) {
+        std::cout << " | " << typeToString(static_cast<ObjectType>(t)) << "s " << simulator.getTypeCount(t);
     }
+    if (simulator.isGameOver()) {
+        std::cout << " | Winner: " << typeToString(simulator.getWinner());
+    } else if (simulator.isDecided()) {
+        std::cout << " | Decided: " << typeToString(simulator.getWinner()) << " wins in about "
+                  << std::setprecision(0) << simulator.estimateRemainingGenerations() << " more generations";
+    }
+    std::cout << "\n";
+    return 0;
+}
 
-    // Get the winning type
-    ObjectType getWinner() const {
-        int rocks, papers, scissors;
-        getTypeCounts(rocks, papers, scissors);
-
-        if (rocks > 0) return ObjectType::ROCK;
-        if (papers > 0) return ObjectType::PAPER;
-        if (scissors > 0) return ObjectType::SCISSORS;
+#ifdef RPS_ENABLE_SESSIONS
+// Play --sessions consecutive seeds as live sessions, each paced at --fps
+// like an interactive view would be, all multiplexed onto the --threads
+// workers, and report how closely they kept to their frame deadlines
+template <typename Simulator>
+static int runSessions(const CommandLineOptions& options) {
+    SimulationParams params = options.params;
+    params.threads = 1;                 // The scheduler supplies the parallelism
+    SessionPacing pacing;
+    if (options.fps > 0) pacing.fps = options.fps;
+    pacing.generationsPerFrame = options.sessionStep;
+    pacing.maxGenerations = params.maxGenerations;
+    pacing.untilDecided = options.untilDecided;
+
+    auto setupStart = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<Simulator>> simulators;
+    simulators.reserve(options.sessions);
+    for (int i = 0; i < options.sessions; i++) {
+        simulators.emplace_back(new Simulator(params, options.seed + i));
+        if (options.reorder) simulators.back()->setSpatialReordering(true);
+    }
+    double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count();
+
+    // Each session only touches its own tally
+    struct Tally {
+        uint64_t frames = 0;
+        uint64_t skipped = 0;
+        double lateness = 0.0;
+        double maxLateness = 0.0;
+    };
+    std::vector<Tally> tallies(options.sessions);
+    SessionScheduler scheduler(options.threads);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.sessions; i++) {
+        scheduler.spawn(liveSession(scheduler, *simulators[i], pacing,
+                                    [&tally = tallies[i]](const Simulator&, const FrameTiming& timing) {
+            tally.frames++;
+            tally.skipped += timing.skipped;
+            tally.lateness += timing.lateness;
+            tally.maxLateness = std::max(tally.maxLateness, timing.lateness);
+            return true;
+        }));
+    }
+    scheduler.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Tally total;
+    uint64_t generations = 0;
+    uint64_t wins[Simulator::typeCount] = {};
+    uint64_t undecided = 0;
+    for (int i = 0; i < options.sessions; i++) {
+        total.frames += tallies[i].frames;
+        total.skipped += tallies[i].skipped;
+        total.lateness += tallies[i].lateness;
+        total.maxLateness = std::max(total.maxLateness, tallies[i].maxLateness);
+        generations += simulators[i]->getGeneration();
+        if (simulators[i]->isDecided()) wins[static_cast<int>(simulators[i]->getWinner())]++;
+        else undecided++;
+    }
 
-        return ObjectType::ROCK; // Fallback
+    std::cout << "Sessions: " << options.sessions << " x " << simulators[0]->getAgents().size() << " agents | Box: "
+              << params.boxWidth << "x" << params.boxHeight << " | Seeds: " << options.seed << "-"
+              << options.seed + options.sessions - 1 << " | Threads: " << scheduler.getThreadCount() << "\n";
+    std::cout << "Setup: " << std::fixed << std::setprecision(1) << setupSeconds * 1000 << " ms\n";
+    std::cout << "Pacing: " << std::setprecision(1) << pacing.fps << " frames/s, " << pacing.generationsPerFrame
+              << " generations per frame\n";
+    std::cout << "Frames: " << total.frames << " in " << std::setprecision(3) << seconds << " s ("
+              << std::setprecision(0) << (seconds > 0 ? total.frames / seconds : 0.0) << " frames/s, "
+              << (seconds > 0 ? generations / seconds : 0.0) << " generations/s)\n";
+    std::cout << "Lateness: mean " << std::setprecision(2) << 1000 * total.lateness / std::max<uint64_t>(1, total.frames)
+              << " ms | max " << 1000 * total.maxLateness << " ms | catch-ups " << total.skipped << "\n";
+    std::cout << "Winners:";
+    for (int t = 0; t < Simulator::typeCount; t++) {
+        std::cout << (t ? " | " : " ") << typeToString(static_cast<ObjectType>(t)) << " " << wins[t];
     }
+    std::cout << " | Undecided " << undecided << "\n";
+    return 0;
+}
+#endif
+
+// Headless run on the fixed-point engine. The checksum covers the final
+// state, so runs on different machines can be compared line for line.
+template <typename Simulator>
+static int runHeadlessQuantized(const CommandLineOptions& options) {
+    const SimulationParams& params = options.params;
+    Simulator simulator(params, options.seed);
+    const uint64_t agentCount = simulator.getAgentCount();
+
+    auto start = std::chrono::steady_clock::now();
+    auto running = [&] {
+        return !(options.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    while (simulator.getGeneration() < params.maxGenerations && running()) simulator.update();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int rocks, papers, scissors;
+    simulator.getTypeCounts(rocks, papers, scissors);
+    double perSecond = seconds > 0 ? simulator.getGeneration() / seconds : 0.0;
+
+    std::cout << "Agents: " << agentCount << " | Box: " << simulator.getBoxWidth() << "x"
+              << simulator.getBoxHeight() << " | Seed: " << simulator.getSeed() << " | Quantized\n";
+    std::cout << "State: " << std::fixed << std::setprecision(2)
+              << static_cast<double>(simulator.stateBytes()) / std::max<uint64_t>(1, agentCount)
+              << " bytes/agent\n";
+    std::cout << "Generations: " << simulator.getGeneration() << " in " << std::setprecision(3)
+              << seconds << " s\n";
+    std::cout << "Generations/second: " << std::setprecision(1) << perSecond << "\n";
+    std::cout << "Agent-updates/second: " << std::setprecision(0) << perSecond * agentCount << "\n";
+    std::cout << "Checksum: " << std::hex << std::setw(16) << std::setfill('0') << simulator.checksum()
+              << std::dec << std::setfill(' ') << "\n";
+    std::cout << "Final: Rocks " << rocks << " | Papers " << papers << " | Scissors " << scissors;
+    for (int t = 3; t < Simulator::typeCount; t++) {
+        std::cout << " | " << typeToString(static_cast<ObjectType>(t)) << "s " << simulator.getTypeCount(t);
+    }
+    if (simulator.isGameOver()) {
+        std::cout << " | Winner: " << typeToString(simulator.getWinner());
+    } else if (simulator.isDecided()) {
+        std::cout << " | Decided: " << typeToString(simulator.getWinner());
+    }
+    std::cout << "\n";
+    return 0;
+}
 
-    // Display current state
-    void displayState() const {
-        int rocks, papers, scissors;
-        getTypeCounts(rocks, papers, scissors);
+#ifdef RPS_ENABLE_CUDA
+// Headless run on the CUDA backend; each generation copies back only the counts
+static int runHeadlessGpu(const CommandLineOptions& options) {
+    const SimulationParams& params = options.params;
+    CudaRPSSimulator simulator(params, options.seed);
+    const uint64_t agentCount = simulator.getAgents().size();
+
+    auto start = std::chrono::steady_clock::now();
+    auto running = [&] {
+        return !(options.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    while (simulator.getGeneration() < params.maxGenerations && running()) simulator.update();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int rocks, papers, scissors;
+    simulator.getTypeCounts(rocks, papers, scissors);
+    double perSecond = seconds > 0 ? simulator.getGeneration() / seconds : 0.0;
+
+    std::cout << "Agents: " << agentCount << " | Box: " << simulator.getBoxWidth() << "x"
+              << simulator.getBoxHeight() << " | Seed: " << simulator.getSeed()
+              << " | Device: " << CudaRPSSimulator::getDeviceName() << "\n";
+    std::cout << "Generations: " << simulator.getGeneration() << " in " << std::fixed << std::setprecision(3)
+              << seconds << " s\n";
+    std::cout << "Generations/second: " << std::setprecision(1) << perSecond << "\n";
+    std::cout << "Agent-updates/second: " << std::setprecision(0) << perSecond * agentCount << "\n";
+    std::cout << "Final: Rocks " << rocks << " | Papers " << papers << " | Scissors " << scissors;
+    if (simulator.isGameOver()) {
+        std::cout << " | Winner: " << typeToString(simulator.getWinner());
+    } else if (simulator.isDecided()) {
+        std::cout << " | Decided: " << typeToString(simulator.getWinner());
+    }
+    std::cout << "\n";
+    return 0;
+}
+#endif
+
+#ifdef RPS_ENABLE_MPI
+// Headless run split across the MPI ranks; rank 0 reports
+template <typename Simulator>
+static int runHeadlessDistributed(const CommandLineOptions& options) {
+    const SimulationParams& params = options.params;
+    Simulator simulator(params, options.seed);
+    const uint64_t agentCount = simulator.getAgentCount();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto start = std::chrono::steady_clock::now();
+    auto running = [&] {
+        return !(options.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    while (simulator.getGeneration() < params.maxGenerations && running()) simulator.update();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (simulator.getRank() != 0) return 0;
+
+    int rocks, papers, scissors;
+    simulator.getTypeCounts(rocks, papers, scissors);
+    double perSecond = seconds > 0 ? simulator.getGeneration() / seconds : 0.0;
+
+    std::cout << "Agents: " << agentCount << " | Box: " << simulator.getBoxWidth() << "x"
+              << simulator.getBoxHeight() << " | Seed: " << simulator.getSeed()
+              << " | Ranks: " << simulator.getRankCount() << "\n";
+    std::cout << "Generations: " << simulator.getGeneration() << " in " << std::fixed << std::setprecision(3)
+              << seconds << " s\n";
+    std::cout << "Generations/second: " << std::setprecision(1) << perSecond << "\n";
+    std::cout << "Agent-updates/second: " << std::setprecision(0) << perSecond * agentCount << "\n";
+    std::cout << "Final: Rocks " << rocks << " | Papers " << papers << " | Scissors " << scissors;
+    for (int t = 3; t < Simulator::typeCount; t++) {
+        std::cout << " | " << typeToString(static_cast<ObjectType>(t)) << "s " << simulator.getTypeCount(t);
+    }
+    if (simulator.isGameOver()) {
+        std::cout << " | Winner: " << typeToString(simulator.getWinner());
+    } else if (simulator.isDecided()) {
+        std::cout << " | Decided: " << typeToString(simulator.getWinner());
+    }
+    std::cout << "\n";
+    return 0;
+}
 
-        std::cout << "\n" << std::string(50, '=') << "\n";
-        std::cout << "Generation: " << generation << "\n";
-        std::cout << "Rocks: " << rocks << " | Papers: " << papers << " | Scissors: " << scissors << "\n";
+// MPI is only initialised for --distributed, so plain runs need no mpirun.
+// An error on any rank aborts the whole job rather than leaving the others
+// blocked in a collective.
+static int runDistributed(int argc, char** argv, const CommandLineOptions& options) {
+    MPI_Init(&argc, &argv);
+    int result = 0;
+    try {
+        if (options.ruleTypes == 5) {
+            result = runHeadlessDistributed<DistributedLizardSpockSimulator>(options);
+        } else {
+            result = runHeadlessDistributed<DistributedRPSSimulator>(options);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Finalize();
+    return result;
+}
+#endif
+
+// Print a trajectory's header and one frame, read straight from the mapping
+static int runReplay(const CommandLineOptions& options) {
+    TrajectoryReader reader(options.replayPath);
+    std::cout << "Trajectory: " << options.replayPath << "\n";
+    std::cout << "Agents: " << reader.getAgentCount() << " | Box: " << reader.getBoxWidth() << "x"
+              << reader.getBoxHeight() << " | Seed: " << reader.getSeed()
+              << " | Frames: " << reader.getFrameCount() << "\n";
+    if (reader.getFrameCount() == 0) return 0;
+
+    size_t index = options.replayFrame < 0 ? reader.getFrameCount() - 1 : static_cast<size_t>(options.replayFrame);
+    TrajectoryFrame frame = reader.frame(index);
+    int rocks, papers, scissors;
+    frame.getTypeCounts(rocks, papers, scissors);
+    std::cout << "Frame " << index << ": generation " << frame.getGeneration() << " | Rocks " << rocks
+              << " | Papers " << papers << " | Scissors " << scissors << " | Conversions since previous "
+              << frame.getConversionCount() << "\n";
+    return 0;
+}
 
-        // Simple visual representation
-        std::cout << "\nSimulation Box (" << boxWidth << "x" << boxHeight << "):\n";
-        for (int y = 0; y < 20; y++) {
-            for (int x = 0; x < 40; x++) {
-                bool found = false;
-                for (const auto& obj : objects) {
-                    int objX = static_cast<int>(obj.x * 40 / boxWidth);
-                    int objY = static_cast<int>(obj.y * 20 / boxHeight);
+// Sweep starting mixes over a range of seeds and print who wins how often
+static int runEnsemble(const CommandLineOptions& options) {
+    std::vector<SimulationParams> grid;
+    for (int rocks : {3, 5, 8}) {
+        SimulationParams params = options.params;
+        params.rocks = rocks;
+        grid.push_back(params);
+    }
 
-                    if (objX == x && objY == y) {
-                        std::cout << typeToSymbol(obj.type);
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) std::cout << ".";
+    EnsembleRunner runner(options.threads);
+    uint64_t seeds = options.ensembleSeeds;
+    std::cout << "Running " << grid.size() << " starting mixes x " << seeds << " seeds on "
+              << runner.getThreadCount() << " threads...\n";
+    for (const auto& summary : runner.run(grid, options.seed, seeds)) {
+        const SimulationParams& p = summary.params;
+        std::cout << "\nRocks " << p.rocks << " | Papers " << p.papers << " | Scissors " << p.scissors
+                  << " (" << summary.runs << " runs)\n";
+        for (int t = 0; t < 3; t++) {
+            std::cout << "  " << std::setw(10) << std::left << typeToString(static_cast<ObjectType>(t))
+                      << std::right << std::fixed << std::setprecision(1)
+                      << 100.0 * summary.wins[t] / std::max<uint64_t>(1, summary.runs) << "%\n";
+        }
+        std::cout << "  Unfinished " << summary.unfinished << "\n";
+        std::cout << "  Generations until " << (summary.untilDecided ? "decided" : "extinction")
+                  << " (bucket of " << summary.bucketWidth << "):";
+        for (size_t b = 0; b < summary.extinctionHistogram.size(); b++) {
+            if (summary.extinctionHistogram[b]) {
+                std::cout << " " << b * summary.bucketWidth << ":" << summary.extinctionHistogram[b];
             }
-            std::cout << "\n";
+        }
+        std::cout << "\n";
+        if (summary.untilDecided && summary.finished() > 0) {
+            std::cout << "  Estimated generations to extinction (mean): " << std::setprecision(0)
+                      << summary.estimatedExtinctionSum / summary.finished() << "\n";
         }
     }
-};
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CommandLineOptions options;
+    if (!parseCommandLine(argc, argv, options)) return argc > 1 && std::string(argv[1]) == "--help" ? 0 : 1;
+    try {
+        if (!options.replayPath.empty()) return runReplay(options);
+        if (options.gpu) {
+#ifdef RPS_ENABLE_CUDA
+            return runHeadlessGpu(options);
+#else
+            throw std::runtime_error("this build has no CUDA backend; configure with -DRPS_ENABLE_CUDA=ON");
+#endif
+        }
+        if (options.distributed) {
+#ifdef RPS_ENABLE_MPI
+            return runDistributed(argc, argv, options);
+#else
+            throw std::runtime_error("this build has no MPI backend; configure with -DRPS_ENABLE_MPI=ON");
+#endif
+        }
+        if (options.sessions > 0) {
+#ifdef RPS_ENABLE_SESSIONS
+            if (options.ruleTypes == 5) return runSessions<LizardSpockSimulator>(options);
+            return runSessions<RPSSimulator>(options);
+#else
+            throw std::runtime_error("this build has no session scheduler; configure with -DRPS_ENABLE_SESSIONS=ON");
+#endif
+        }
+        if (options.quantized && options.ruleTypes == 5) {
+            return runHeadlessQuantized<QuantizedLizardSpockSimulator>(options);
+        }
+        if (options.quantized) return runHeadlessQuantized<QuantizedRPSSimulator>(options);
+        if (options.headless && options.ruleTypes == 5) return runHeadless<LizardSpockSimulator>(options);
+        if (options.headless) return runHeadless<RPSSimulator>(options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    if (options.ensemble) return runEnsemble(options);
+
+    const SimulationParams& params = options.params;
 
-int main() {
     std::cout << "Rock Paper Scissors Simulator\n";
     std::cout << "=============================\n\n";
 
-    // Create simulator with a 100x100 box
-    RPSSimulator simulator(100.0f, 100.0f);
+    // Create simulator with a 100x100 box unless told otherwise
+    SimulationParams startParams = params;
+    startParams.threads = options.threads;
+    RPSSimulator simulator(startParams, options.seed);
+    simulator.setSpatialReordering(options.reorder);
+    simulator.getRenderer().setResolution(options.viewCols, options.viewRows);
+    simulator.getRenderer().setRedrawInPlace(options.redraw);
 
-    std::cout << "Starting simulation with 5 Rocks, 5 Papers, and 5 Scissors...\n";
+    std::cout << "Starting simulation with " << params.rocks << " Rocks, " << params.papers
+              << " Papers, and " << params.scissors << " Scissors...\n";
     std::cout << "Legend: R = Rock, P = Paper, S = Scissors\n";
 
-    // Display initial state
-    simulator.displayState();
-
     // Run simulation
-    int maxGenerations = 1000;
-    for (int gen = 0; gen < maxGenerations && !simulator.isGameOver(); gen++) {
-        simulator.update();
+    int maxGenerations = params.maxGenerations;
+    auto running = [&] {
+        return !(options.untilDecided ? simulator.isDecided() : simulator.isGameOver());
+    };
+    if (options.fps > 0) {
+        // The render thread shows the newest generation at its own pace
+        AsyncDisplay display(simulator.getRenderer(), options.fps);
+        display.publish(simulator, true);
+        for (int gen = 0; gen < maxGenerations && running(); gen++) {
+            simulator.update();
+            display.publish(simulator);
+        }
+        display.publish(simulator, true);
+        display.stop();
+    } else {
+        // Display initial state
+        simulator.displayState();
+
+        for (int gen = 0; gen < maxGenerations && running(); gen++) {
+            simulator.update();
 
-        // Display state every 10 generations
-        if (gen % 10 == 0) {
-            simulator.displayState();
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            // Display state every 10 generations
+            if (gen % 10 == 0) {
+                simulator.displayState();
+                std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            }
         }
     }
 
-    // Display final result
+    // Display final result below the last frame rather than over it
+    simulator.getRenderer().setRedrawInPlace(false);
     std::cout << "\n" << std::string(50, '=') << "\n";
     std::cout << "SIMULATION COMPLETE!\n";
     simulator.displayState();
 
     if (simulator.isGameOver()) {
         std::cout << "\nWinner: " << typeToString(simulator.getWinner()) << "!\n";
+    } else if (simulator.isDecided()) {
+        std::cout << "\nDecided: " << typeToString(simulator.getWinner()) << " will win, in about "
+                  << std::fixed << std::setprecision(0) << simulator.estimateRemainingGenerations()
+                  << " more generations.\n";
     } else {
         std::cout << "\nSimulation ended after maximum generations.\n";
     }
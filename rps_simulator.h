@@ -0,0 +1,4242 @@
+//
+// Created by Harshwardhan Singh on 17/07/25.
+//
+
+#ifndef RPS_SIMULATOR_H
+#define RPS_SIMULATOR_H
+
+#include <iostream>      // For console output
+#include <vector>        // For storing game objects
+#include <cmath>         // For mathematical operations (distance, etc.)
+#include <chrono>        // For timing and seeding random generator
+#include <thread>        // For worker threads
+#include <iomanip>       // For formatted output
+#include <algorithm>     // For sorting broad-phase candidates
+#include <cstddef>       // For aligning scratch arena arrays
+#include <cstdint>       // For packed agent types
+#include <cstdlib>       // For reading the SIMD override from the environment
+#include <cstring>       // For comparing kernel names
+#include <atomic>        // For handing out parallel tasks
+#include <mutex>         // For the worker pool
+#include <condition_variable>
+#include <functional>    // For parallel task bodies
+#include <memory>        // For owning the worker pool
+#include <limits>        // For group bounds
+#include <type_traits>   // For checking what goes in a scratch arena
+#include <iterator>      // For merging group member lists
+#include <deque>         // For work-stealing task queues
+#include <string>        // For type names
+#include <charconv>      // For formatting conversion events
+#include <sstream>       // For formatting display headers
+#include <cstdio>        // For writing trajectory files
+#include <stdexcept>     // For reporting file errors
+#include <cstdarg>       // For formatting trace events
+#include <cctype>        // For lower-case type names in stats output
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RPS_X86_SIMD 1
+#include <immintrin.h>   // For SSE/AVX2/AVX-512 move kernels
+#elif defined(__ARM_NEON)
+#define RPS_NEON_SIMD 1
+#include <arm_neon.h>    // For NEON move kernels
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RPS_POSIX_MMAP 1
+#include <fcntl.h>       // For mapping trajectory files
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RPS_POSIX_SOCKETS 1
+#include <sys/socket.h>  // For serving metrics
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
+
+#ifdef RPS_COUNT_ALLOCATIONS
+// Heap allocations made by the current thread so far, counted by the
+// replacement operator new in rps_alloc_counter.cpp. With
+// RPS_COUNT_ALLOCATIONS set, update() checks that a generation whose
+// scratch buffers did not grow allocated nothing, on its own thread or on
+// the worker pool. Background writer threads are not counted.
+inline thread_local uint64_t heapAllocationCount = 0;
+#endif
+
+
+// The classic three types come first; rule sets with more types carry on
+// past SCISSORS, and types beyond the named ones are just numbered
+enum class ObjectType {
+    ROCK,
+    PAPER,
+    SCISSORS,
+    SPOCK,
+    LIZARD
+};
+
+// Convert enum to string for display
+inline std::string typeToString(ObjectType type) {
+    switch(type) {
+        case ObjectType::ROCK: return "Rock";
+        case ObjectType::PAPER: return "Paper";
+        case ObjectType::SCISSORS: return "Scissors";
+        case ObjectType::SPOCK: return "Spock";
+        case ObjectType::LIZARD: return "Lizard";
+    }
+    return "Type " + std::to_string(static_cast<int>(type));
+}
+
+// Lower-case type name, for CSV columns and metric labels
+inline std::string typeToKey(ObjectType type) {
+    std::string name = typeToString(type);
+    for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return name;
+}
+
+// Convert enum to symbol for compact display
+inline char typeToSymbol(ObjectType type) {
+    switch(type) {
+        case ObjectType::ROCK: return 'R';
+        case ObjectType::PAPER: return 'P';
+        case ObjectType::SCISSORS: return 'S';
+        case ObjectType::SPOCK: return 'K';
+        case ObjectType::LIZARD: return 'L';
+    }
+    int t = static_cast<int>(type);
+    return t < 10 ? static_cast<char>('0' + t) : '?';
+}
+
+// Balanced cyclic tournament over Types types: type t beats the types an
+// odd number of steps before it, wrapping around, so every type beats
+// exactly half of the others. Three types are Rock-Paper-Scissors; five
+// are Rock-Paper-Scissors-Spock-Lizard. The winner of every pair is worked
+// out at compile time into a flat table, so a lookup is a single load.
+template <int Types>
+struct CyclicRuleSet {
+    static_assert(Types >= 3 && Types % 2 == 1, "every pair needs a winner, so the type count must be odd");
+    static_assert(Types <= 255, "types are stored in a uint8_t");
+
+    static constexpr int typeCount = Types;
+
+    struct Table {
+        uint8_t winner[Types * Types];   // winner[a * Types + b]
+    };
+
+    static constexpr Table makeTable() {
+        Table table{};
+        for (int a = 0; a < Types; a++) {
+            for (int b = 0; b < Types; b++) {
+                int stepsBack = (a - b + Types) % Types;
+                table.winner[a * Types + b] = static_cast<uint8_t>(stepsBack % 2 == 1 || a == b ? a : b);
+            }
+        }
+        return table;
+    }
+
+    static constexpr Table table = makeTable();
+
+    static constexpr uint8_t winner(uint8_t a, uint8_t b) { return table.winner[a * Types + b]; }
+};
+
+using ClassicRules = CyclicRuleSet<3>;
+using LizardSpockRules = CyclicRuleSet<5>;
+
+static_assert(ClassicRules::winner(0, 2) == 0 && ClassicRules::winner(1, 0) == 1 && ClassicRules::winner(2, 1) == 2,
+              "rock blunts scissors, paper covers rock, scissors cut paper");
+static_assert(LizardSpockRules::winner(4, 3) == 4 && LizardSpockRules::winner(3, 0) == 3 &&
+              LizardSpockRules::winner(0, 4) == 0 && LizardSpockRules::winner(2, 4) == 2,
+              "lizard poisons Spock, Spock vaporizes rock, rock crushes lizard, scissors decapitate lizard");
+
+// Same result as std::sqrt(dx * dx + dy * dy) < contact, without the sqrt
+// for clear hits and misses. The squared distance is compared against a band
+// around contact^2 that is far wider than any rounding in either form; only
+// pairs inside the band fall back to the sqrt comparison.
+inline bool withinContact(float dx, float dy, float contact) {
+    float distanceSq = dx * dx + dy * dy;
+    float contactSq = contact * contact;
+    if (distanceSq < contactSq * 0.99999f) return true;
+    if (distanceSq > contactSq * 1.00001f) return false;
+    return std::sqrt(distanceSq) < contact;
+}
+
+// Reference to an agent's type, which is stored packed as a uint8_t
+class TypeRef {
+private:
+    uint8_t* slot;
+
+public:
+    explicit TypeRef(uint8_t& s) : slot(&s) {}
+
+    operator ObjectType() const { return static_cast<ObjectType>(*slot); }
+
+    TypeRef& operator=(ObjectType t) {
+        *slot = static_cast<uint8_t>(t);
+        return *this;
+    }
+
+    TypeRef& operator=(const TypeRef& other) {
+        *slot = *other.slot;
+        return *this;
+    }
+};
+
+// Lightweight view of one agent inside an AgentStore. Writes through the
+// view go straight to the underlying arrays.
+class GameObject {
+public:
+    TypeRef type;
+    float& x;
+    float& y;             // Position
+    float& vx;
+    float& vy;            // Velocity
+    float& radius;        // For collision detection; shared unless per-agent radii are enabled
+
+    GameObject(uint8_t& t, float& px, float& py, float& velX, float& velY, float& r)
+        : type(t), x(px), y(py), vx(velX), vy(velY), radius(r) {}
+
+    // Update position based on velocity
+    void update() {
+        x += vx;
+        y += vy;
+    }
+
+    // Check collision with another object
+    bool collidesWith(const GameObject& other) const {
+        return withinContact(x - other.x, y - other.y, radius + other.radius);
+    }
+
+    // Handle boundary bouncing
+    void handleBoundaries(float width, float height) {
+        if (x - radius <= 0 || x + radius >= width) {
+            vx = -vx;
+            x = std::max(radius, std::min(width - radius, x));
+        }
+        if (y - radius <= 0 || y + radius >= height) {
+            vy = -vy;
+            y = std::max(radius, std::min(height - radius, y));
+        }
+    }
+};
+
+// Structure-of-arrays storage for every agent in a simulation. Positions,
+// velocities and types live in separate contiguous arrays so the move and
+// boundary steps stream through memory and vectorize.
+class AgentStore {
+public:
+    static constexpr float defaultRadius = 5.0f;
+
+    std::vector<float> x, y;        // Positions
+    std::vector<float> vx, vy;      // Velocities
+    std::vector<uint8_t> type;      // ObjectType per agent
+    std::vector<float> radii;       // Per-agent radii, empty unless enabled
+    float radius = defaultRadius;   // Shared radius used when radii is empty
+
+    size_t size() const { return type.size(); }
+    bool empty() const { return type.empty(); }
+
+    void clear() {
+        x.clear(); y.clear();
+        vx.clear(); vy.clear();
+        type.clear();
+        radii.clear();
+    }
+
+    void reserve(size_t n) {
+        x.reserve(n); y.reserve(n);
+        vx.reserve(n); vy.reserve(n);
+        type.reserve(n);
+        if (hasPerAgentRadii()) radii.reserve(n);
+    }
+
+    // Grow or shrink to n agents; new agents are zeroed rocks for the caller to fill
+    void resize(size_t n) {
+        x.resize(n); y.resize(n);
+        vx.resize(n); vy.resize(n);
+        type.resize(n);
+        if (hasPerAgentRadii()) radii.resize(n, radius);
+    }
+
+    void add(ObjectType t, float startX, float startY, float velX, float velY) {
+        x.push_back(startX);
+        y.push_back(startY);
+        vx.push_back(velX);
+        vy.push_back(velY);
+        type.push_back(static_cast<uint8_t>(t));
+        if (hasPerAgentRadii()) radii.push_back(radius);
+    }
+
+    // Give every agent its own radius, initialised from the shared one
+    void enablePerAgentRadii() {
+        if (perAgentRadii) return;
+        perAgentRadii = true;
+        radii.assign(size(), radius);
+    }
+
+    bool hasPerAgentRadii() const { return perAgentRadii; }
+
+    float maxRadius() const {
+        if (!perAgentRadii || radii.empty()) return radius;
+        return *std::max_element(radii.begin(), radii.end());
+    }
+
+    GameObject operator[](size_t i) {
+        return GameObject(type[i], x[i], y[i], vx[i], vy[i], perAgentRadii ? radii[i] : radius);
+    }
+
+private:
+    bool perAgentRadii = false;
+};
+
+// One agent changing type. agent was converted by converter during the
+// update that produced generation.
+struct ConversionEvent {
+    uint32_t generation;
+    uint32_t agent;
+    uint32_t converter;
+    uint8_t fromType;
+    uint8_t toType;
+    uint8_t padding[2] = {0, 0};
+};
+static_assert(sizeof(ConversionEvent) == 16, "conversion events are written as raw records");
+
+// Collects conversion events in a buffer allocated once up front. When it
+// fills, the whole batch goes to the sink in one call. Without a sink the
+// log just keeps growing, which is how the parallel path buffers events
+// per collision group.
+class ConversionLog {
+public:
+    using Sink = std::function<void(const ConversionEvent* events, size_t count)>;
+
+    explicit ConversionLog(Sink sink = nullptr, size_t capacity = 4096)
+        : sink(std::move(sink)), capacity(std::max<size_t>(1, capacity)) {
+        events.reserve(this->capacity);
+    }
+
+    ~ConversionLog() { flush(); }
+
+    ConversionLog(const ConversionLog&) = delete;
+    ConversionLog& operator=(const ConversionLog&) = delete;
+    ConversionLog(ConversionLog&&) = default;
+    ConversionLog& operator=(ConversionLog&&) = default;
+
+    // Binary ConversionEvent records, for files and pipes alike
+    static Sink fileSink(std::FILE* file) {
+        return [file](const ConversionEvent* batch, size_t count) {
+            std::fwrite(batch, sizeof(ConversionEvent), count, file);
+        };
+    }
+
+    // One "generation,agent,converter,from,to" line per event
+    static Sink textSink(std::ostream& out) {
+        // The text buffer lives in the sink and keeps its capacity between batches
+        return [&out, text = std::string()](const ConversionEvent* batch, size_t count) mutable {
+            text.clear();
+            auto number = [&](uint32_t value) {
+                char digits[10];
+                text.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+                text += ',';
+            };
+            for (size_t e = 0; e < count; e++) {
+                const ConversionEvent& event = batch[e];
+                number(event.generation);
+                number(event.agent);
+                number(event.converter);
+                text += typeToString(static_cast<ObjectType>(event.fromType));
+                text += ',';
+                text += typeToString(static_cast<ObjectType>(event.toType));
+                text += '\n';
+            }
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        };
+    }
+
+    void setGeneration(uint32_t g) { generation = g; }
+    uint32_t getGeneration() const { return generation; }
+
+    void push(uint32_t agent, uint32_t converter, ObjectType from, ObjectType to) {
+        if (sink && events.size() == capacity) flush();
+        ConversionEvent event;
+        event.generation = generation;
+        event.agent = agent;
+        event.converter = converter;
+        event.fromType = static_cast<uint8_t>(from);
+        event.toType = static_cast<uint8_t>(to);
+        events.push_back(event);
+    }
+
+    // Hand every buffered event to the sink
+    void flush() {
+        if (sink && !events.empty()) sink(events.data(), events.size());
+        events.clear();
+    }
+
+    // Buffered events, for logs without a sink
+    std::vector<ConversionEvent>& buffered() { return events; }
+    const std::vector<ConversionEvent>& buffered() const { return events; }
+
+private:
+    Sink sink;
+    size_t capacity;
+    std::vector<ConversionEvent> events;
+    uint32_t generation = 0;
+};
+
+// Population of a run at one generation, as a StatsFeed delivers it
+struct PopulationSample {
+    static constexpr int maxTypes = 5;      // Every ObjectType
+    static constexpr int clusterGrid = 32;  // Cells per side used to measure clustering
+
+    int generation = 0;
+    int typeCount = 0;
+    int counts[maxTypes] = {};
+    uint64_t conversionTotal = 0;   // Conversions the simulator has resolved so far
+    uint64_t conversions = 0;       // Conversions since the previous sample
+    double conversionRate = 0.0;    // Those conversions per agent per generation
+    double meanSpeed = 0.0;
+    // Same-type neighbours within clusterGrid x clusterGrid cells, rescaled
+    // so 0 is a well-mixed box and 1 is one where every cell holds one type
+    double clustering = 0.0;
+
+    int agentCount() const {
+        int total = 0;
+        for (int t = 0; t < typeCount; t++) total += counts[t];
+        return total;
+    }
+};
+
+// Takes a PopulationSample every `interval` generations of the simulator it
+// is attached to (see setStatsFeed) and hands them to each subscribed sink
+// in batches, so observing a run costs one sample per interval and one sink
+// call per batch. Sinks run on the simulation thread.
+class StatsFeed {
+public:
+    using Sink = std::function<void(const PopulationSample* samples, size_t count)>;
+
+    explicit StatsFeed(int interval = 100) : interval(interval) {
+        if (interval <= 0) throw std::runtime_error("stats interval must be positive");
+    }
+
+    ~StatsFeed() { flush(); }
+
+    StatsFeed(const StatsFeed&) = delete;
+    StatsFeed& operator=(const StatsFeed&) = delete;
+
+    // Deliver samples to sink batchSize at a time; 1 sends each as it is taken
+    void subscribe(Sink sink, size_t batchSize = 64) {
+        subscribers.push_back({std::move(sink), std::max<size_t>(1, batchSize), {}});
+        subscribers.back().pending.reserve(subscribers.back().batchSize);
+    }
+
+    // One "generation,<type>...,conversions,conversion_rate,mean_speed,clustering"
+    // line per sample, after a header line
+    static Sink csvSink(std::FILE* file) {
+        return [file, header = true](const PopulationSample* batch, size_t count) mutable {
+            if (header && count > 0) {
+                std::fputs("generation", file);
+                for (int t = 0; t < batch[0].typeCount; t++) {
+                    std::fprintf(file, ",%s", typeToKey(static_cast<ObjectType>(t)).c_str());
+                }
+                std::fputs(",conversions,conversion_rate,mean_speed,clustering\n", file);
+                header = false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                const PopulationSample& sample = batch[i];
+                std::fprintf(file, "%d", sample.generation);
+                for (int t = 0; t < sample.typeCount; t++) std::fprintf(file, ",%d", sample.counts[t]);
+                std::fprintf(file, ",%llu,%.6g,%.6g,%.6g\n", static_cast<unsigned long long>(sample.conversions),
+                             sample.conversionRate, sample.meanSpeed, sample.clustering);
+            }
+        };
+    }
+
+    int getInterval() const { return interval; }
+    bool due(int generation) const { return !subscribers.empty() && generation % interval == 0; }
+
+    // Start counting conversions from this point; setStatsFeed calls it
+    void setBaseline(int generation, uint64_t conversionTotal) {
+        previousGeneration = generation;
+        previousConversions = conversionTotal;
+    }
+
+    // Fill in the conversions since the previous sample and queue it for
+    // every sink, passing on any batch that fills
+    void push(PopulationSample sample) {
+        sample.conversions = sample.conversionTotal - previousConversions;
+        int generations = sample.generation - previousGeneration;
+        int agents = sample.agentCount();
+        sample.conversionRate = generations > 0 && agents > 0
+            ? static_cast<double>(sample.conversions) / (static_cast<double>(generations) * agents) : 0.0;
+        setBaseline(sample.generation, sample.conversionTotal);
+
+        for (Subscriber& subscriber : subscribers) {
+            subscriber.pending.push_back(sample);
+            if (subscriber.pending.size() >= subscriber.batchSize) deliver(subscriber);
+        }
+    }
+
+    // Hand every queued sample to its sink
+    void flush() {
+        for (Subscriber& subscriber : subscribers) deliver(subscriber);
+    }
+
+private:
+    struct Subscriber {
+        Sink sink;
+        size_t batchSize;
+        std::vector<PopulationSample> pending;
+    };
+
+    static void deliver(Subscriber& subscriber) {
+        if (!subscriber.pending.empty()) subscriber.sink(subscriber.pending.data(), subscriber.pending.size());
+        subscriber.pending.clear();
+    }
+
+    int interval;
+    int previousGeneration = 0;
+    uint64_t previousConversions = 0;
+    std::vector<Subscriber> subscribers;
+};
+
+#ifdef RPS_POSIX_SOCKETS
+// Serves the latest sample from a StatsFeed as Prometheus text metrics at
+// http://address:port/metrics. Scrapes are answered on a background thread,
+// so the simulation thread only copies each sample in under a lock.
+class PrometheusExporter {
+public:
+    // Port 0 picks a free port; see getPort. Throws std::runtime_error if
+    // the address can't be bound.
+    explicit PrometheusExporter(uint16_t port, const char* address = "127.0.0.1") {
+        sockaddr_in bound = {};
+        bound.sin_family = AF_INET;
+        bound.sin_port = htons(port);
+        if (inet_pton(AF_INET, address, &bound.sin_addr) != 1) {
+            throw std::runtime_error(std::string("invalid metrics address ") + address);
+        }
+        listener = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) throw std::runtime_error("cannot open a metrics socket");
+        int reuse = 1;
+        ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        socklen_t length = sizeof(bound);
+        if (::bind(listener, reinterpret_cast<sockaddr*>(&bound), sizeof(bound)) != 0 ||
+            ::listen(listener, 16) != 0 ||
+            ::getsockname(listener, reinterpret_cast<sockaddr*>(&bound), &length) != 0) {
+            ::close(listener);
+            throw std::runtime_error("cannot serve metrics on " + std::string(address) + ":" +
+                                     std::to_string(port));
+        }
+        this->port = ntohs(bound.sin_port);
+        server = std::thread([this] { serve(); });
+    }
+
+    ~PrometheusExporter() {
+        stopping = true;
+        server.join();
+        ::close(listener);
+    }
+
+    PrometheusExporter(const PrometheusExporter&) = delete;
+    PrometheusExporter& operator=(const PrometheusExporter&) = delete;
+
+    // Subscribe this with a batch size of 1 so scrapes see each sample as it is taken
+    StatsFeed::Sink sink() {
+        return [this](const PopulationSample* batch, size_t count) {
+            if (count == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            latest = batch[count - 1];
+            sampled = true;
+        };
+    }
+
+    uint16_t getPort() const { return port; }
+
+private:
+    void serve() {
+        std::string response;
+        while (!stopping) {
+            pollfd waiting = {listener, POLLIN, 0};
+            if (::poll(&waiting, 1, 100) <= 0) continue;    // Wake regularly to notice stopping
+            int client = ::accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+
+            // Only the request line matters; anything past it is ignored
+            char request[1024];
+            size_t received = 0;
+            pollfd reading = {client, POLLIN, 0};
+            while (received < sizeof(request) - 1 && ::poll(&reading, 1, 1000) > 0) {
+                ssize_t got = ::recv(client, request + received, sizeof(request) - 1 - received, 0);
+                if (got <= 0) break;
+                received += static_cast<size_t>(got);
+                request[received] = '\0';
+                if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) break;
+            }
+            request[received] = '\0';
+
+            bool metrics = std::strncmp(request, "GET /metrics", 12) == 0 &&
+                           (request[12] == ' ' || request[12] == '?');
+            std::string body = metrics ? render() : "Not found\n";
+            response = metrics ? "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                               : "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+            response += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+            response += body;
+            for (size_t sent = 0; sent < response.size();) {
+                ssize_t wrote = ::send(client, response.data() + sent, response.size() - sent, sendFlags);
+                if (wrote <= 0) break;
+                sent += static_cast<size_t>(wrote);
+            }
+            ::close(client);
+        }
+    }
+
+    std::string render() {
+        PopulationSample sample;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!sampled) return "";
+            sample = latest;
+        }
+        std::ostringstream out;
+        out << std::setprecision(9);
+        auto gauge = [&](const char* name, const char* help, const char* type) {
+            out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        };
+        gauge("rps_generation", "Generation of the latest sample.", "gauge");
+        out << "rps_generation " << sample.generation << "\n";
+        gauge("rps_agents", "Agents of each type.", "gauge");
+        for (int t = 0; t < sample.typeCount; t++) {
+            out << "rps_agents{type=\"" << typeToKey(static_cast<ObjectType>(t)) << "\"} " << sample.counts[t] << "\n";
+        }
+        gauge("rps_conversions_total", "Conversions resolved so far.", "counter");
+        out << "rps_conversions_total " << sample.conversionTotal << "\n";
+        gauge("rps_conversion_rate", "Conversions per agent per generation since the previous sample.", "gauge");
+        out << "rps_conversion_rate " << sample.conversionRate << "\n";
+        gauge("rps_mean_speed", "Mean agent speed.", "gauge");
+        out << "rps_mean_speed " << sample.meanSpeed << "\n";
+        gauge("rps_clustering", "Same-type clustering, 0 for a well-mixed box and 1 for segregated types.",
+              "gauge");
+        out << "rps_clustering " << sample.clustering << "\n";
+        return out.str();
+    }
+
+#ifdef MSG_NOSIGNAL
+    static constexpr int sendFlags = MSG_NOSIGNAL;   // A scraper hanging up must not kill the run
+#else
+    static constexpr int sendFlags = 0;
+#endif
+
+    int listener = -1;
+    uint16_t port = 0;
+    std::atomic<bool> stopping{false};
+    std::thread server;
+    std::mutex mutex;
+    PopulationSample latest;
+    bool sampled = false;
+};
+#endif
+
+// Collision rules for a rule set such as ClassicRules; GameRules is the
+// Rock-Paper-Scissors instance
+template <typename RuleSet>
+class BasicGameRules {
+public:
+    // Distance each object is pushed apart after a collision
+    static constexpr float separationForce = 2.0f;
+
+    // Determine winner between two object types; a type meeting itself wins
+    static ObjectType determineWinner(ObjectType type1, ObjectType type2) {
+        return static_cast<ObjectType>(RuleSet::winner(static_cast<uint8_t>(type1), static_cast<uint8_t>(type2)));
+    }
+
+    // A game is decided once one remaining type beats every other remaining
+    // type: it converts whatever it meets and nothing can convert it, so it
+    // only ever grows. With three types that is as soon as at most two are
+    // left. counts holds RuleSet::typeCount populations. Sets winner and
+    // returns true in that case.
+    static bool decidedWinner(const int* counts, ObjectType& winner) {
+        int present = 0;
+        for (int t = 0; t < RuleSet::typeCount; t++) present += counts[t] > 0;
+        if (present == 0) {
+            winner = ObjectType::ROCK;
+            return true;
+        }
+        for (int t = 0; t < RuleSet::typeCount; t++) {
+            if (counts[t] == 0) continue;
+            bool beatsAll = true;
+            for (int u = 0; u < RuleSet::typeCount && beatsAll; u++) {
+                beatsAll = counts[u] == 0 || RuleSet::winner(static_cast<uint8_t>(t), static_cast<uint8_t>(u)) == t;
+            }
+            if (beatsAll) {
+                winner = static_cast<ObjectType>(t);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool decidedWinner(int rocks, int papers, int scissors, ObjectType& winner) {
+        int counts[RuleSet::typeCount] = {rocks, papers, scissors};
+        return decidedWinner(counts, winner);
+    }
+
+    // Apply collision result to two objects. If typeCounts is set, the
+    // per-type populations it holds are kept in step with any conversion.
+    // If log is set, the conversion is pushed to it under the given agent
+    // indices.
+    static void resolveCollision(GameObject& obj1, GameObject& obj2, int* typeCounts = nullptr,
+                                 ConversionLog* log = nullptr, uint32_t agent1 = 0, uint32_t agent2 = 0) {
+        ObjectType type1 = obj1.type;
+        ObjectType type2 = obj2.type;
+        ObjectType winner = determineWinner(type1, type2);
+
+        if (type1 != type2) {
+            bool firstLoses = type1 != winner;
+            ObjectType loser = firstLoses ? type1 : type2;
+            if (typeCounts) {
+                typeCounts[static_cast<int>(loser)]--;
+                typeCounts[static_cast<int>(winner)]++;
+            }
+            if (log) {
+                log->push(firstLoses ? agent1 : agent2, firstLoses ? agent2 : agent1, loser, winner);
+            }
+        }
+
+        // Both objects become the winning type
+        obj1.type = winner;
+        obj2.type = winner;
+
+        // Add some separation to prevent immediate re-collision
+        float dx = obj1.x - obj2.x;
+        float dy = obj1.y - obj2.y;
+        float distance = std::sqrt(dx * dx + dy * dy);
+
+        if (distance > 0) {
+            obj1.x += (dx / distance) * separationForce;
+            obj1.y += (dy / distance) * separationForce;
+            obj2.x -= (dx / distance) * separationForce;
+            obj2.y -= (dy / distance) * separationForce;
+        }
+    }
+};
+
+using GameRules = BasicGameRules<ClassicRules>;
+
+// Per-axis move-step kernels over AgentStore arrays. integrate adds the
+// velocity to the position; reflect bounces agents off the walls at 0 and
+// extent. Every variant gives bit-identical results to GameObject::update
+// and GameObject::handleBoundaries: wall hits are computed as lane masks
+// and applied with selects, so there are no per-agent branches.
+//
+// radii is null when all agents share sharedRadius.
+struct MoveKernels {
+    const char* name;
+    void (*integrate)(float* pos, const float* vel, size_t n);
+    void (*reflect)(float* pos, float* vel, const float* radii, float sharedRadius,
+                    size_t n, float extent);
+
+    // Best kernel set for this CPU, chosen once at first use. Setting
+    // RPS_SIMD=scalar|sse|avx2|avx512|neon forces a specific set if available.
+    static const MoveKernels& active();
+};
+
+inline void integrateScalar(float* pos, const float* vel, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        pos[i] += vel[i];
+    }
+}
+
+inline void reflectOne(float* pos, float* vel, size_t i, float r, float extent) {
+    float p = pos[i];
+    bool hit = (p - r <= 0) | (p + r >= extent);
+    vel[i] = hit ? -vel[i] : vel[i];
+    pos[i] = hit ? std::max(r, std::min(extent - r, p)) : p;
+}
+
+inline void reflectScalar(float* pos, float* vel, const float* radii, float sharedRadius,
+                          size_t n, float extent) {
+    if (radii) {
+        for (size_t i = 0; i < n; i++) reflectOne(pos, vel, i, radii[i], extent);
+    } else {
+        for (size_t i = 0; i < n; i++) reflectOne(pos, vel, i, sharedRadius, extent);
+    }
+}
+
+// Remainder lanes after the vector loop
+inline void reflectTail(float* pos, float* vel, const float* radii, float sharedRadius,
+                               size_t begin, size_t n, float extent) {
+    for (size_t i = begin; i < n; i++) {
+        reflectOne(pos, vel, i, radii ? radii[i] : sharedRadius, extent);
+    }
+}
+
+// Note on operand order: std::min(a, b) is (b < a) ? b : a, which matches
+// min_ps(b, a), and std::max(a, b) matches max_ps(b, a). Keeping that order
+// makes ties resolve the same way as the scalar path.
+
+#if defined(RPS_X86_SIMD)
+
+__attribute__((target("sse2")))
+inline void integrateSse(float* pos, const float* vel, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(pos + i, _mm_add_ps(_mm_loadu_ps(pos + i), _mm_loadu_ps(vel + i)));
+    }
+    integrateScalar(pos + i, vel + i, n - i);
+}
+
+__attribute__((target("sse2")))
+inline void reflectSse(float* pos, float* vel, const float* radii, float sharedRadius,
+                       size_t n, float extent) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 ext = _mm_set1_ps(extent);
+    __m128 r = _mm_set1_ps(sharedRadius);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (radii) r = _mm_loadu_ps(radii + i);
+        __m128 p = _mm_loadu_ps(pos + i);
+        __m128 v = _mm_loadu_ps(vel + i);
+        __m128 hit = _mm_or_ps(_mm_cmple_ps(_mm_sub_ps(p, r), zero),
+                               _mm_cmpge_ps(_mm_add_ps(p, r), ext));
+        __m128 clamped = _mm_max_ps(_mm_min_ps(p, _mm_sub_ps(ext, r)), r);
+        _mm_storeu_ps(vel + i, _mm_xor_ps(v, _mm_and_ps(hit, signBit)));
+        _mm_storeu_ps(pos + i, _mm_or_ps(_mm_and_ps(hit, clamped), _mm_andnot_ps(hit, p)));
+    }
+    reflectTail(pos, vel, radii, sharedRadius, i, n, extent);
+}
+
+__attribute__((target("avx2")))
+inline void integrateAvx2(float* pos, const float* vel, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(pos + i, _mm256_add_ps(_mm256_loadu_ps(pos + i), _mm256_loadu_ps(vel + i)));
+    }
+    integrateScalar(pos + i, vel + i, n - i);
+}
+
+__attribute__((target("avx2")))
+inline void reflectAvx2(float* pos, float* vel, const float* radii, float sharedRadius,
+                        size_t n, float extent) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 ext = _mm256_set1_ps(extent);
+    __m256 r = _mm256_set1_ps(sharedRadius);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        if (radii) r = _mm256_loadu_ps(radii + i);
+        __m256 p = _mm256_loadu_ps(pos + i);
+        __m256 v = _mm256_loadu_ps(vel + i);
+        __m256 hit = _mm256_or_ps(_mm256_cmp_ps(_mm256_sub_ps(p, r), zero, _CMP_LE_OQ),
+                                  _mm256_cmp_ps(_mm256_add_ps(p, r), ext, _CMP_GE_OQ));
+        __m256 clamped = _mm256_max_ps(_mm256_min_ps(p, _mm256_sub_ps(ext, r)), r);
+        _mm256_storeu_ps(vel + i, _mm256_xor_ps(v, _mm256_and_ps(hit, signBit)));
+        _mm256_storeu_ps(pos + i, _mm256_blendv_ps(p, clamped, hit));
+    }
+    reflectTail(pos, vel, radii, sharedRadius, i, n, extent);
+}
+
+__attribute__((target("avx512f")))
+inline void integrateAvx512(float* pos, const float* vel, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(pos + i, _mm512_add_ps(_mm512_loadu_ps(pos + i), _mm512_loadu_ps(vel + i)));
+    }
+    integrateScalar(pos + i, vel + i, n - i);
+}
+
+// GCC flags the deliberately undefined pass-through operand inside the
+// AVX-512 min/max intrinsics
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+__attribute__((target("avx512f")))
+inline void reflectAvx512(float* pos, float* vel, const float* radii, float sharedRadius,
+                          size_t n, float extent) {
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512i signBit = _mm512_set1_epi32(static_cast<int>(0x80000000u));
+    const __m512 ext = _mm512_set1_ps(extent);
+    __m512 r = _mm512_set1_ps(sharedRadius);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        if (radii) r = _mm512_loadu_ps(radii + i);
+        __m512 p = _mm512_loadu_ps(pos + i);
+        __m512 v = _mm512_loadu_ps(vel + i);
+        __mmask16 hit = _mm512_cmp_ps_mask(_mm512_sub_ps(p, r), zero, _CMP_LE_OQ)
+                      | _mm512_cmp_ps_mask(_mm512_add_ps(p, r), ext, _CMP_GE_OQ);
+        __m512 clamped = _mm512_max_ps(_mm512_min_ps(p, _mm512_sub_ps(ext, r)), r);
+        __m512i bits = _mm512_castps_si512(v);
+        _mm512_storeu_ps(vel + i, _mm512_castsi512_ps(_mm512_mask_xor_epi32(bits, hit, bits, signBit)));
+        _mm512_storeu_ps(pos + i, _mm512_mask_blend_ps(hit, p, clamped));
+    }
+    reflectTail(pos, vel, radii, sharedRadius, i, n, extent);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#elif defined(RPS_NEON_SIMD)
+
+inline void integrateNeon(float* pos, const float* vel, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(pos + i, vaddq_f32(vld1q_f32(pos + i), vld1q_f32(vel + i)));
+    }
+    integrateScalar(pos + i, vel + i, n - i);
+}
+
+inline void reflectNeon(float* pos, float* vel, const float* radii, float sharedRadius,
+                        size_t n, float extent) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t ext = vdupq_n_f32(extent);
+    float32x4_t r = vdupq_n_f32(sharedRadius);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        if (radii) r = vld1q_f32(radii + i);
+        float32x4_t p = vld1q_f32(pos + i);
+        float32x4_t v = vld1q_f32(vel + i);
+        uint32x4_t hit = vorrq_u32(vcleq_f32(vsubq_f32(p, r), zero),
+                                   vcgeq_f32(vaddq_f32(p, r), ext));
+        float32x4_t clamped = vmaxq_f32(vminq_f32(p, vsubq_f32(ext, r)), r);
+        vst1q_f32(vel + i, vbslq_f32(hit, vnegq_f32(v), v));
+        vst1q_f32(pos + i, vbslq_f32(hit, clamped, p));
+    }
+    reflectTail(pos, vel, radii, sharedRadius, i, n, extent);
+}
+
+#endif
+
+// Pick the kernel set named by RPS_SIMD, or the last (widest) one available
+template <typename Kernels>
+inline Kernels selectKernels(const std::vector<Kernels>& available) {
+    if (const char* forced = std::getenv("RPS_SIMD")) {
+        for (const auto& k : available) {
+            if (std::strcmp(k.name, forced) == 0) return k;
+        }
+    }
+    return available.back();
+}
+
+inline const MoveKernels& MoveKernels::active() {
+    static const MoveKernels selected = [] {
+        std::vector<MoveKernels> available = {{"scalar", integrateScalar, reflectScalar}};
+#if defined(RPS_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2")) available.push_back({"sse", integrateSse, reflectSse});
+        if (__builtin_cpu_supports("avx2")) available.push_back({"avx2", integrateAvx2, reflectAvx2});
+        if (__builtin_cpu_supports("avx512f")) available.push_back({"avx512", integrateAvx512, reflectAvx512});
+#elif defined(RPS_NEON_SIMD)
+        available.push_back({"neon", integrateNeon, reflectNeon});
+#endif
+        return selectKernels(available);
+    }();
+    return selected;
+}
+
+// Batched narrow phase: test agent `self` against a batch of broad-phase
+// candidate indices and write the batch offsets of the ones it touches, in
+// order, to hits. Stops after maxHits hits and returns the number written.
+//
+// The vector variants compare squared distances against a slightly widened
+// contact^2 for a whole batch at once, then confirm the few lanes that pass
+// with withinContact, so results always match GameObject::collidesWith.
+struct NarrowPhaseKernels {
+    const char* name;
+    size_t (*collectHits)(const AgentStore& agents, size_t self, const int* candidates,
+                          size_t count, int* hits, size_t maxHits);
+
+    static const NarrowPhaseKernels& active();
+};
+
+inline bool agentsTouch(const AgentStore& agents, size_t a, size_t b) {
+    float ra = agents.hasPerAgentRadii() ? agents.radii[a] : agents.radius;
+    float rb = agents.hasPerAgentRadii() ? agents.radii[b] : agents.radius;
+    return withinContact(agents.x[a] - agents.x[b], agents.y[a] - agents.y[b], ra + rb);
+}
+
+inline size_t collectHitsScalar(const AgentStore& agents, size_t self, const int* candidates,
+                                size_t count, int* hits, size_t maxHits) {
+    size_t found = 0;
+    for (size_t k = 0; k < count && found < maxHits; k++) {
+        if (agentsTouch(agents, self, candidates[k])) hits[found++] = static_cast<int>(k);
+    }
+    return found;
+}
+
+// Upper bound on contact^2 used by the vector pre-filter; anything beyond it
+// is a guaranteed miss for withinContact
+constexpr float contactFilterScale = 1.0001f;
+
+// Scalar remainder after the vector loop, with offsets relative to the batch
+inline size_t collectHitsTail(const AgentStore& agents, size_t self, const int* candidates,
+                                     size_t begin, size_t count, int* hits, size_t maxHits) {
+    if (maxHits == 0) return 0;
+    size_t found = collectHitsScalar(agents, self, candidates + begin, count - begin, hits, maxHits);
+    for (size_t h = 0; h < found; h++) {
+        hits[h] += static_cast<int>(begin);
+    }
+    return found;
+}
+
+#if defined(RPS_X86_SIMD)
+
+__attribute__((target("avx2")))
+inline size_t collectHitsAvx2(const AgentStore& agents, size_t self, const int* candidates,
+                              size_t count, int* hits, size_t maxHits) {
+    const float* xs = agents.x.data();
+    const float* ys = agents.y.data();
+    const bool perAgent = agents.hasPerAgentRadii();
+    const float selfRadius = perAgent ? agents.radii[self] : agents.radius;
+
+    const __m256 xi = _mm256_set1_ps(xs[self]);
+    const __m256 yi = _mm256_set1_ps(ys[self]);
+    const __m256 ri = _mm256_set1_ps(selfRadius);
+    const __m256 scale = _mm256_set1_ps(contactFilterScale);
+    const float sharedContact = selfRadius + agents.radius;
+    __m256 limit = _mm256_set1_ps(sharedContact * sharedContact * contactFilterScale);
+
+    size_t found = 0;
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(candidates + k));
+        __m256 dx = _mm256_sub_ps(xi, _mm256_i32gather_ps(xs, idx, 4));
+        __m256 dy = _mm256_sub_ps(yi, _mm256_i32gather_ps(ys, idx, 4));
+        __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        if (perAgent) {
+            __m256 contact = _mm256_add_ps(ri, _mm256_i32gather_ps(agents.radii.data(), idx, 4));
+            limit = _mm256_mul_ps(_mm256_mul_ps(contact, contact), scale);
+        }
+
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(distanceSq, limit, _CMP_LT_OQ));
+        while (mask) {
+            int lane = __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (agentsTouch(agents, self, candidates[k + lane])) {
+                hits[found++] = static_cast<int>(k + lane);
+                if (found == maxHits) return found;
+            }
+        }
+    }
+    return found + collectHitsTail(agents, self, candidates, k, count, hits + found, maxHits - found);
+}
+
+#elif defined(RPS_NEON_SIMD)
+
+inline size_t collectHitsNeon(const AgentStore& agents, size_t self, const int* candidates,
+                              size_t count, int* hits, size_t maxHits) {
+    const float* xs = agents.x.data();
+    const float* ys = agents.y.data();
+    const bool perAgent = agents.hasPerAgentRadii();
+    const float selfRadius = perAgent ? agents.radii[self] : agents.radius;
+
+    const float32x4_t xi = vdupq_n_f32(xs[self]);
+    const float32x4_t yi = vdupq_n_f32(ys[self]);
+    const float sharedContact = selfRadius + agents.radius;
+    float32x4_t limit = vdupq_n_f32(sharedContact * sharedContact * contactFilterScale);
+
+    size_t found = 0;
+    size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        const int* idx = candidates + k;
+        float bx[4] = {xs[idx[0]], xs[idx[1]], xs[idx[2]], xs[idx[3]]};
+        float by[4] = {ys[idx[0]], ys[idx[1]], ys[idx[2]], ys[idx[3]]};
+        float32x4_t dx = vsubq_f32(xi, vld1q_f32(bx));
+        float32x4_t dy = vsubq_f32(yi, vld1q_f32(by));
+        float32x4_t distanceSq = vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy));
+        if (perAgent) {
+            const float* radii = agents.radii.data();
+            float contact[4];
+            for (int lane = 0; lane < 4; lane++) {
+                float c = selfRadius + radii[idx[lane]];
+                contact[lane] = c * c * contactFilterScale;
+            }
+            limit = vld1q_f32(contact);
+        }
+
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vcltq_f32(distanceSq, limit));
+        for (int lane = 0; lane < 4; lane++) {
+            if (lanes[lane] && agentsTouch(agents, self, idx[lane])) {
+                hits[found++] = static_cast<int>(k + lane);
+                if (found == maxHits) return found;
+            }
+        }
+    }
+    return found + collectHitsTail(agents, self, candidates, k, count, hits + found, maxHits - found);
+}
+
+#endif
+
+inline const NarrowPhaseKernels& NarrowPhaseKernels::active() {
+    static const NarrowPhaseKernels selected = [] {
+        std::vector<NarrowPhaseKernels> available = {{"scalar", collectHitsScalar}};
+#if defined(RPS_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) available.push_back({"avx2", collectHitsAvx2});
+#elif defined(RPS_NEON_SIMD)
+        available.push_back({"neon", collectHitsNeon});
+#endif
+        return selectKernels(available);
+    }();
+    return selected;
+}
+
+// Pair filter for WorldBatch, which stores each agent's fields for its
+// worldBatchWidth worlds side by side. firstTouch compares agent i against
+// agents from..n-1 in turn and stops at the first j where any world's pair
+// is closer than limit (a squared distance), setting the bit of each such
+// world in lanes. It returns n if there is none. Callers confirm the lanes
+// with withinContact, as the narrow phase does.
+constexpr size_t worldBatchWidth = 8;
+
+struct WorldBatchKernels {
+    const char* name;
+    size_t (*firstTouch)(const float* x, const float* y, size_t i, size_t from, size_t n, float limit,
+                         unsigned& lanes);
+
+    static const WorldBatchKernels& active();
+};
+
+inline size_t firstTouchScalar(const float* x, const float* y, size_t i, size_t from, size_t n, float limit,
+                               unsigned& lanes) {
+    const float* xi = x + i * worldBatchWidth;
+    const float* yi = y + i * worldBatchWidth;
+    for (size_t j = from; j < n; j++) {
+        const float* xj = x + j * worldBatchWidth;
+        const float* yj = y + j * worldBatchWidth;
+        unsigned mask = 0;
+        for (size_t lane = 0; lane < worldBatchWidth; lane++) {
+            float dx = xi[lane] - xj[lane], dy = yi[lane] - yj[lane];
+            mask |= static_cast<unsigned>(dx * dx + dy * dy < limit) << lane;
+        }
+        if (mask) {
+            lanes = mask;
+            return j;
+        }
+    }
+    return n;
+}
+
+#if defined(RPS_X86_SIMD)
+
+__attribute__((target("sse2")))
+inline size_t firstTouchSse(const float* x, const float* y, size_t i, size_t from, size_t n, float limit,
+                            unsigned& lanes) {
+    const __m128 lim = _mm_set1_ps(limit);
+    const __m128 xlo = _mm_loadu_ps(x + i * 8), xhi = _mm_loadu_ps(x + i * 8 + 4);
+    const __m128 ylo = _mm_loadu_ps(y + i * 8), yhi = _mm_loadu_ps(y + i * 8 + 4);
+    for (size_t j = from; j < n; j++) {
+        __m128 dxl = _mm_sub_ps(xlo, _mm_loadu_ps(x + j * 8)), dxh = _mm_sub_ps(xhi, _mm_loadu_ps(x + j * 8 + 4));
+        __m128 dyl = _mm_sub_ps(ylo, _mm_loadu_ps(y + j * 8)), dyh = _mm_sub_ps(yhi, _mm_loadu_ps(y + j * 8 + 4));
+        __m128 lo = _mm_add_ps(_mm_mul_ps(dxl, dxl), _mm_mul_ps(dyl, dyl));
+        __m128 hi = _mm_add_ps(_mm_mul_ps(dxh, dxh), _mm_mul_ps(dyh, dyh));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(lo, lim))) |
+                        static_cast<unsigned>(_mm_movemask_ps(_mm_cmplt_ps(hi, lim))) << 4;
+        if (mask) {
+            lanes = mask;
+            return j;
+        }
+    }
+    return n;
+}
+
+__attribute__((target("avx2")))
+inline size_t firstTouchAvx2(const float* x, const float* y, size_t i, size_t from, size_t n, float limit,
+                             unsigned& lanes) {
+    const __m256 lim = _mm256_set1_ps(limit);
+    const __m256 xi = _mm256_loadu_ps(x + i * 8);
+    const __m256 yi = _mm256_loadu_ps(y + i * 8);
+    for (size_t j = from; j < n; j++) {
+        __m256 dx = _mm256_sub_ps(xi, _mm256_loadu_ps(x + j * 8));
+        __m256 dy = _mm256_sub_ps(yi, _mm256_loadu_ps(y + j * 8));
+        __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distanceSq, lim, _CMP_LT_OQ)));
+        if (mask) {
+            lanes = mask;
+            return j;
+        }
+    }
+    return n;
+}
+
+#elif defined(RPS_NEON_SIMD)
+
+inline size_t firstTouchNeon(const float* x, const float* y, size_t i, size_t from, size_t n, float limit,
+                             unsigned& lanes) {
+    const float32x4_t lim = vdupq_n_f32(limit);
+    const float32x4_t xlo = vld1q_f32(x + i * 8), xhi = vld1q_f32(x + i * 8 + 4);
+    const float32x4_t ylo = vld1q_f32(y + i * 8), yhi = vld1q_f32(y + i * 8 + 4);
+    const uint32x4_t bits = {1, 2, 4, 8};
+    for (size_t j = from; j < n; j++) {
+        float32x4_t dxl = vsubq_f32(xlo, vld1q_f32(x + j * 8)), dxh = vsubq_f32(xhi, vld1q_f32(x + j * 8 + 4));
+        float32x4_t dyl = vsubq_f32(ylo, vld1q_f32(y + j * 8)), dyh = vsubq_f32(yhi, vld1q_f32(y + j * 8 + 4));
+        float32x4_t lo = vaddq_f32(vmulq_f32(dxl, dxl), vmulq_f32(dyl, dyl));
+        float32x4_t hi = vaddq_f32(vmulq_f32(dxh, dxh), vmulq_f32(dyh, dyh));
+        unsigned mask = vaddvq_u32(vandq_u32(vcltq_f32(lo, lim), bits)) |
+                        vaddvq_u32(vandq_u32(vcltq_f32(hi, lim), bits)) << 4;
+        if (mask) {
+            lanes = mask;
+            return j;
+        }
+    }
+    return n;
+}
+
+#endif
+
+inline const WorldBatchKernels& WorldBatchKernels::active() {
+    static const WorldBatchKernels selected = [] {
+        std::vector<WorldBatchKernels> available = {{"scalar", firstTouchScalar}};
+#if defined(RPS_X86_SIMD)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2")) available.push_back({"sse", firstTouchSse});
+        if (__builtin_cpu_supports("avx2")) available.push_back({"avx2", firstTouchAvx2});
+#elif defined(RPS_NEON_SIMD)
+        available.push_back({"neon", firstTouchNeon});
+#endif
+        return selectKernels(available);
+    }();
+    return selected;
+}
+
+// Uniform-grid broad phase. Agents are binned into square cells with a
+// counting sort, so a neighbour query only visits the block of cells
+// around a point instead of every agent in the box.
+//
+// A grid can bin the whole store or just a subset of it. Entries are
+// "slots": positions in the member list, which is in ascending agent order,
+// so ascending slots are ascending agents. Without a member list slot and
+// agent index are the same thing.
+class SpatialGrid {
+private:
+    float originX = 0.0f, originY = 0.0f;
+    float cellSize = 1.0f;
+    int cols = 0, rows = 0;
+    std::vector<int> cellStart;      // Offset of each cell's first entry in cellItems
+    std::vector<int> cellItems;      // Slots sorted by cell, ascending within a cell
+
+    // Agents that drifted too far from their cell during collision
+    // resolution are re-binned into per-cell linked lists
+    std::vector<int> overflowHead;
+    std::vector<int> overflowNext;
+    std::vector<int> overflowSlot;
+    std::vector<int> currentEntry;   // Live overflow entry per slot, -1 if still in cellItems
+
+    // Type bitmasks per cell, for markInert
+    std::vector<uint8_t> cellTypes;
+    std::vector<uint8_t> blockTypes;
+
+    int cellCoord(float v, float origin, int count) const {
+        return std::max(0, std::min(count - 1, static_cast<int>(std::floor((v - origin) / cellSize))));
+    }
+
+    int cellOf(float x, float y) const {
+        return cellCoord(y, originY, rows) * cols + cellCoord(x, originX, cols);
+    }
+
+    void layout(size_t count, float minX, float minY, float maxX, float maxY, float minCellSize) {
+        // Cap the cell count relative to the agent count so a sparse box
+        // does not pay for a huge, mostly empty grid
+        size_t maxCells = std::max<size_t>(64, 4 * count);
+        originX = minX;
+        originY = minY;
+        cellSize = minCellSize;
+        do {
+            cols = std::max(1, static_cast<int>(std::ceil((maxX - minX) / cellSize)));
+            rows = std::max(1, static_cast<int>(std::ceil((maxY - minY) / cellSize)));
+            if (static_cast<size_t>(cols) * rows <= maxCells) break;
+            cellSize *= 2.0f;
+        } while (true);
+    }
+
+public:
+    // Rebuild the grid over [minX, maxX] x [minY, maxY] with cells at least
+    // minCellSize wide. members lists the agents to bin in ascending order,
+    // or is null to bin all of them. Positions outside the bounds fall into
+    // the edge cells. Slots flagged in asleep are left out, so queries never
+    // return them.
+    void build(const AgentStore& agents, const int* members, size_t count,
+               float minX, float minY, float maxX, float maxY, float minCellSize,
+               const uint8_t* asleep = nullptr) {
+        layout(count, minX, minY, maxX, maxY, minCellSize);
+
+        size_t cellCount = static_cast<size_t>(cols) * rows;
+        cellStart.assign(cellCount + 1, 0);
+        cellItems.resize(count);
+        currentEntry.assign(count, -1);
+        overflowHead.assign(cellCount, -1);
+        overflowNext.clear();
+        overflowSlot.clear();
+
+        // Counting sort: histogram, prefix sum, then scatter in slot order
+        auto cellOfSlot = [&](size_t slot) {
+            size_t index = members ? members[slot] : slot;
+            return cellOf(agents.x[index], agents.y[index]);
+        };
+        for (size_t slot = 0; slot < count; slot++) {
+            if (!asleep || !asleep[slot]) cellStart[cellOfSlot(slot) + 1]++;
+        }
+        for (size_t c = 0; c < cellCount; c++) {
+            cellStart[c + 1] += cellStart[c];
+        }
+        overflowNext.assign(cellStart.begin(), cellStart.end() - 1);  // Reused as scatter cursor
+        for (size_t slot = 0; slot < count; slot++) {
+            if (!asleep || !asleep[slot]) cellItems[overflowNext[cellOfSlot(slot)]++] = static_cast<int>(slot);
+        }
+        overflowNext.clear();
+    }
+
+    // Flag in asleep every one of the first count agents whose cell and
+    // eight neighbouring cells hold no other type, using the cells build()
+    // lays out for the same arguments. Any pair such an agent can touch is
+    // two agents of one type. Returns how many were flagged.
+    size_t markInert(const AgentStore& agents, size_t count, float minX, float minY, float maxX, float maxY,
+                     float minCellSize, std::vector<uint8_t>& asleep) {
+        layout(count, minX, minY, maxX, maxY, minCellSize);
+        size_t cellCount = static_cast<size_t>(cols) * rows;
+        cellTypes.assign(cellCount, 0);
+        for (size_t i = 0; i < count; i++) {
+            cellTypes[cellOf(agents.x[i], agents.y[i])] |= static_cast<uint8_t>(1u << agents.type[i]);
+        }
+
+        // Types in each 3x3 block, spread along rows and then down columns
+        blockTypes.resize(cellCount);
+        for (int r = 0; r < rows; r++) {
+            const uint8_t* in = cellTypes.data() + static_cast<size_t>(r) * cols;
+            uint8_t* out = blockTypes.data() + static_cast<size_t>(r) * cols;
+            for (int c = 0; c < cols; c++) {
+                out[c] = in[c] | (c > 0 ? in[c - 1] : 0) | (c + 1 < cols ? in[c + 1] : 0);
+            }
+        }
+        for (int r = 0; r < rows; r++) {
+            uint8_t* out = cellTypes.data() + static_cast<size_t>(r) * cols;
+            const uint8_t* mid = blockTypes.data() + static_cast<size_t>(r) * cols;
+            const uint8_t* above = r > 0 ? mid - cols : nullptr;
+            const uint8_t* below = r + 1 < rows ? mid + cols : nullptr;
+            for (int c = 0; c < cols; c++) {
+                out[c] = mid[c] | (above ? above[c] : 0) | (below ? below[c] : 0);
+            }
+        }
+
+        asleep.resize(count);
+        size_t flagged = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t types = cellTypes[cellOf(agents.x[i], agents.y[i])];
+            asleep[i] = (types & (types - 1)) == 0;
+            flagged += asleep[i];
+        }
+        return flagged;
+    }
+
+    float getCellSize() const { return cellSize; }
+
+    // Bytes held by the grid's arrays, which builds reuse
+    size_t capacityBytes() const {
+        return sizeof(int) * (cellStart.capacity() + cellItems.capacity() + overflowHead.capacity() +
+                              overflowNext.capacity() + overflowSlot.capacity() + currentEntry.capacity()) +
+               cellTypes.capacity() + blockTypes.capacity();
+    }
+
+    // Move a slot to the cell containing (x, y)
+    void rebin(int slot, float x, float y) {
+        int cell = cellOf(x, y);
+        int entry = static_cast<int>(overflowSlot.size());
+        overflowSlot.push_back(slot);
+        overflowNext.push_back(overflowHead[cell]);
+        overflowHead[cell] = entry;
+        currentEntry[slot] = entry;
+    }
+
+    // Collect, in ascending order, every slot greater than minSlot that is
+    // binned in the 3x3 block of cells around (x, y)
+    void query(float x, float y, int minSlot, std::vector<int>& out) const {
+        out.clear();
+        int cx = cellCoord(x, originX, cols);
+        int cy = cellCoord(y, originY, rows);
+
+        for (int ny = std::max(0, cy - 1); ny <= std::min(rows - 1, cy + 1); ny++) {
+            for (int nx = std::max(0, cx - 1); nx <= std::min(cols - 1, cx + 1); nx++) {
+                int cell = ny * cols + nx;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    int slot = cellItems[k];
+                    if (slot > minSlot && currentEntry[slot] < 0) out.push_back(slot);
+                }
+                for (int e = overflowHead[cell]; e >= 0; e = overflowNext[e]) {
+                    int slot = overflowSlot[e];
+                    if (slot > minSlot && currentEntry[slot] == e) out.push_back(slot);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+
+    // Collect, unordered, every slot binned in a cell that overlaps the
+    // square of half-width range around (x, y). Re-binned entries are not
+    // consulted, so this is only meaningful before any rebin.
+    void queryRange(float x, float y, float range, std::vector<int>& out) const {
+        out.clear();
+        int x0 = cellCoord(x - range, originX, cols), x1 = cellCoord(x + range, originX, cols);
+        int y0 = cellCoord(y - range, originY, rows), y1 = cellCoord(y + range, originY, rows);
+
+        for (int ny = y0; ny <= y1; ny++) {
+            for (int nx = x0; nx <= x1; nx++) {
+                int cell = ny * cols + nx;
+                out.insert(out.end(), cellItems.begin() + cellStart[cell], cellItems.begin() + cellStart[cell + 1]);
+            }
+        }
+    }
+};
+
+// Bump allocator for scratch arrays that only live for one generation.
+// Arrays are carved out of one block and all released by reset(). When a
+// generation needs more than the block holds, the rest comes from overflow
+// blocks, and the next reset() swaps them for a single block big enough
+// for everything that generation used. Once the block has grown to the
+// largest generation seen, updates take no memory from the heap.
+class ScratchArena {
+private:
+    std::unique_ptr<unsigned char[]> block;
+    size_t capacity = 0;
+    size_t used = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> overflow;
+    size_t overflowBytes = 0;
+    size_t growCount = 0;
+
+public:
+    // Uninitialized space for count values of T, valid until the next reset()
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena arrays are never destroyed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "blocks only guarantee max_align_t");
+        size_t bytes = count * sizeof(T);
+        size_t offset = (used + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (offset + bytes <= capacity) {
+            used = offset + bytes;
+            return reinterpret_cast<T*>(block.get() + offset);
+        }
+        overflow.emplace_back(new unsigned char[bytes]);
+        overflowBytes += bytes + alignof(std::max_align_t);
+        return reinterpret_cast<T*>(overflow.back().get());
+    }
+
+    // Release every array handed out since the last reset
+    void reset() {
+        if (!overflow.empty()) {
+            capacity += overflowBytes;
+            block.reset(new unsigned char[capacity]);
+            overflow.clear();
+            overflowBytes = 0;
+            growCount++;
+        }
+        used = 0;
+    }
+
+    size_t bytesReserved() const { return capacity; }
+
+    // Times the block has been regrown; steady once this stops changing
+    size_t growths() const { return growCount; }
+};
+
+// Fixed set of threads for fork-join loops. The calling thread takes part
+// as worker 0, so a pool of N workers starts N - 1 helper threads.
+class WorkerPool {
+private:
+    std::vector<std::thread> helpers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    void (*job)(void*, size_t, unsigned) = nullptr;  // Calls the body run() was given
+    void* jobBody = nullptr;
+    size_t jobTasks = 0;
+    std::atomic<size_t> nextTask{0};
+    unsigned activeHelpers = 0;
+    uint64_t jobEpoch = 0;
+    bool stopping = false;
+#ifdef RPS_COUNT_ALLOCATIONS
+    std::atomic<uint64_t> helperAllocations{0};
+#endif
+
+    void drain(unsigned worker) {
+#ifdef RPS_COUNT_ALLOCATIONS
+        uint64_t allocationsBefore = heapAllocationCount;
+#endif
+        for (size_t task; (task = nextTask.fetch_add(1)) < jobTasks;) {
+            job(jobBody, task, worker);
+        }
+#ifdef RPS_COUNT_ALLOCATIONS
+        if (worker != 0) helperAllocations += heapAllocationCount - allocationsBefore;
+#endif
+    }
+
+    void helperLoop(unsigned worker) {
+        uint64_t seenEpoch = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return stopping || jobEpoch != seenEpoch; });
+            if (stopping) return;
+            seenEpoch = jobEpoch;
+            lock.unlock();
+            drain(worker);
+            lock.lock();
+            if (--activeHelpers == 0) finished.notify_one();
+        }
+    }
+
+public:
+    explicit WorkerPool(unsigned workers) {
+        for (unsigned w = 1; w < workers; w++) {
+            helpers.emplace_back(&WorkerPool::helperLoop, this, w);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : helpers) t.join();
+    }
+
+    unsigned size() const { return static_cast<unsigned>(helpers.size()) + 1; }
+
+#ifdef RPS_COUNT_ALLOCATIONS
+    // Heap allocations helper threads have made while running tasks
+    uint64_t helperAllocationCount() const { return helperAllocations; }
+#endif
+
+    // Run fn(task, worker) for every task in [0, taskCount) and return once
+    // all of them have finished. Tasks are handed out dynamically. fn is
+    // called in place rather than copied into a std::function, so a run
+    // never allocates.
+    template <typename Fn>
+    void run(size_t taskCount, Fn&& fn) {
+        if (taskCount == 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = [](void* body, size_t task, unsigned worker) {
+                (*static_cast<std::remove_reference_t<Fn>*>(body))(task, worker);
+            };
+            jobBody = const_cast<void*>(static_cast<const void*>(&fn));
+            jobTasks = taskCount;
+            nextTask = 0;
+            activeHelpers = static_cast<unsigned>(helpers.size());
+            jobEpoch++;
+        }
+        wake.notify_all();
+        drain(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return activeHelpers == 0; });
+    }
+};
+
+// Position of an agent after it was separated from a hit while resolving
+// the pair with the given lexicographic key
+struct HitRecord {
+    uint64_t key;
+    int agent;
+    float x, y;
+};
+
+// Z-order index of a cell: the bits of two 16-bit cell coordinates
+// interleaved, x in the even bits. Cells close in the box mostly get close
+// codes, which is what the spatial reorder sorts agents by.
+inline uint32_t mortonCode(uint32_t cellX, uint32_t cellY) {
+    auto spread = [](uint32_t v) {
+        v &= 0xFFFF;
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(cellX) | (spread(cellY) << 1);
+}
+
+// Where one generation's time went and how much collision work it did.
+// Builds configured with -DRPS_ENABLE_PROFILING=ON define RPS_PROFILE and
+// fill these in from update(). Otherwise PhaseTimer and PairCounters are
+// empty, the instrumentation compiles away and the stats stay zero.
+struct GenerationStats {
+    // Detection is building the broad-phase grid, or for swept collisions
+    // finding and ordering the contacts. Resolution is the pair scan with
+    // its narrow-phase tests, conversions and separation. Reorder is the
+    // spatial re-sort, when enabled; it runs before the move.
+    enum Phase { MOVE, BOUNDARIES, DETECTION, RESOLUTION, REORDER, PHASE_COUNT };
+
+#ifdef RPS_PROFILE
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    int generation = 0;
+    double phaseStart[PHASE_COUNT] = {};    // steady_clock seconds when each phase began
+    double phaseSeconds[PHASE_COUNT] = {};
+    uint64_t pairsTested = 0;       // Candidate pairs put through the narrow phase
+    uint64_t pairsColliding = 0;    // Pairs found touching and resolved
+    uint64_t conversions = 0;       // Colliding pairs of different types
+
+    static const char* phaseName(int phase) {
+        static const char* const names[PHASE_COUNT] = {"move", "boundaries", "detection", "resolution", "reorder"};
+        return names[phase];
+    }
+
+    double totalSeconds() const {
+        double total = 0.0;
+        for (double seconds : phaseSeconds) total += seconds;
+        return total;
+    }
+};
+
+// Adds the time until it goes out of scope to one phase
+class PhaseTimer {
+#ifdef RPS_PROFILE
+private:
+    GenerationStats& stats;
+    GenerationStats::Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+    static double seconds(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double>(t.time_since_epoch()).count();
+    }
+
+public:
+    PhaseTimer(GenerationStats& s, GenerationStats::Phase p)
+        : stats(s), phase(p), start(std::chrono::steady_clock::now()) {}
+
+    ~PhaseTimer() {
+        auto end = std::chrono::steady_clock::now();
+        if (stats.phaseSeconds[phase] == 0.0) stats.phaseStart[phase] = seconds(start);
+        stats.phaseSeconds[phase] += std::chrono::duration<double>(end - start).count();
+    }
+#else
+public:
+    PhaseTimer(GenerationStats&, GenerationStats::Phase) {}
+#endif
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+// Collision work tallied by one thread or collision group, so parallel
+// passes count without sharing a counter. Only conversions are counted in
+// builds without RPS_PROFILE.
+struct PairCounters {
+    uint64_t conversions = 0;       // Always counted, for PopulationSample
+#ifdef RPS_PROFILE
+    uint64_t tested = 0, colliding = 0;
+
+    void test(size_t pairs) { tested += pairs; }
+    void collide(bool converted) {
+        colliding++;
+        conversions += converted;
+    }
+    void clear() { tested = colliding = conversions = 0; }
+#else
+    void test(size_t) {}
+    void collide(bool converted) { conversions += converted; }
+    void clear() { conversions = 0; }
+#endif
+};
+
+// Where starting agents are placed
+enum class SpawnLayout {
+    UNIFORM,      // Anywhere in the box
+    CLUSTERED,    // Gaussian clusters, groupsPerType of them per type
+    STRIPES,      // Full-height bands cycling through the types, so fronts meet at every edge
+};
+
+// How starting agents are set moving
+enum class VelocityDistribution {
+    UNIFORM,      // Each component uniform in [-speed, speed]
+    FIXED_SPEED,  // Exactly speed, in a uniformly random direction
+};
+
+// Everything about the starting population but the per-type counts
+struct SpawnSpec {
+    SpawnLayout layout = SpawnLayout::UNIFORM;
+    int groupsPerType = 1;          // Clusters or stripes of each type
+    float clusterSpread = 0.05f;    // Cluster standard deviation, as a fraction of the shorter box side
+    VelocityDistribution velocity = VelocityDistribution::UNIFORM;
+    float speed = 2.0f;
+};
+
+// Starting setup for one simulation
+struct SimulationParams {
+    float boxWidth = 100.0f;
+    float boxHeight = 100.0f;
+    int rocks = 5;
+    int papers = 5;
+    int scissors = 5;
+    std::vector<int> extraTypes;    // Populations of the types after scissors, for larger rule sets
+    int maxGenerations = 1000;
+    float timestep = 1.0f;          // Fraction of its velocity each agent moves per generation
+    bool sweptCollisions = false;   // Detect contacts along the whole move, not just at its end
+    bool inertSleeping = false;     // Skip agents in single-type neighbourhoods, see setInertSleeping
+    SpawnSpec spawn;
+    unsigned threads = 1;           // Starting thread count, see setThreadCount; also fills the population
+};
+
+// Counter-based random numbers. Draw k of stream s is a pure function of
+// (seed, s, k), built from SplitMix64 rounds, so draws can be made on any
+// thread in any order and a run replays exactly from its seed.
+class CounterRng {
+public:
+    explicit CounterRng(uint64_t seed = 0) : seed(seed) {}
+
+    uint64_t getSeed() const { return seed; }
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // A stream's draws all share its key, so code drawing several times
+    // from one stream can derive the key once and use keyedBits
+    uint64_t streamKey(uint64_t stream) const { return mix(seed + golden * (stream + 1)); }
+    static uint64_t keyedBits(uint64_t key, uint64_t counter) { return mix(key + golden * (counter + 1)); }
+
+    uint64_t bits(uint64_t stream, uint64_t counter) const {
+        return keyedBits(streamKey(stream), counter);
+    }
+
+    // Uniform float in [0, 1) from a draw's bits
+    static float unit(uint64_t bits) { return static_cast<float>(bits >> 40) * 0x1.0p-24f; }
+
+    // Uniform float in [lo, hi)
+    float uniform(uint64_t stream, uint64_t counter, float lo, float hi) const {
+        return std::min(lo + (hi - lo) * unit(bits(stream, counter)), std::nextafter(hi, lo));
+    }
+
+private:
+    static constexpr uint64_t golden = 0x9e3779b97f4a7c15ULL;
+    uint64_t seed;
+};
+
+// Places starting agents according to a SpawnSpec. Agent i of an
+// initialisation takes its position and velocity from draws draw..draw+3
+// of stream i, so agents can be spawned in any order, on any thread, and
+// come out the same. The uniform layout and velocities at the default
+// speed give exactly the agents CounterRng::uniform always has.
+class Spawner {
+private:
+    // uniform() over a fixed range, with nextafter hoisted out of the loop
+    struct Range {
+        float lo, span, top;
+        Range(float l = 0.0f, float h = 1.0f) : lo(l), span(h - l), top(std::nextafter(h, l)) {}
+        float at(uint64_t bits) const { return std::min(lo + span * CounterRng::unit(bits), top); }
+    };
+
+    static constexpr float margin = 10.0f;   // Agents start at least this far from every wall
+    static constexpr float twoPi = 6.28318530718f;
+
+    const CounterRng& rng;
+    SpawnSpec spec;
+    uint64_t draw;
+    int typeCount;
+    float boxWidth, boxHeight;
+    Range xRange, yRange, speedRange, angleRange;
+    float spread = 0.0f, stripeWidth = 0.0f;
+    std::vector<float> centers;    // x, y of each cluster, by type * groupsPerType + group
+
+public:
+    Spawner(const CounterRng& random, const SpawnSpec& spawn, uint64_t firstDraw, int types, float width,
+            float height)
+        : rng(random), spec(spawn), draw(firstDraw), typeCount(types), boxWidth(width), boxHeight(height),
+          xRange(margin, width - margin), yRange(margin, height - margin), speedRange(-spawn.speed, spawn.speed),
+          angleRange(0.0f, twoPi) {
+        spec.groupsPerType = std::max(1, spec.groupsPerType);
+        if (spec.layout == SpawnLayout::CLUSTERED) {
+            // Centres draw from streams counting down from the top, far from any agent's
+            spread = spec.clusterSpread * std::min(width, height);
+            for (int c = 0; c < typeCount * spec.groupsPerType; c++) {
+                uint64_t key = rng.streamKey(~uint64_t(0) - c);
+                centers.push_back(xRange.at(CounterRng::keyedBits(key, draw + 0)));
+                centers.push_back(yRange.at(CounterRng::keyedBits(key, draw + 1)));
+            }
+        }
+        stripeWidth = (width - 2 * margin) / static_cast<float>(typeCount * spec.groupsPerType);
+    }
+
+    // Agent index of type t. Groups go round-robin over a type's agents.
+    void spawn(uint64_t index, int t, float& x, float& y, float& vx, float& vy) const {
+        const uint64_t key = rng.streamKey(index);
+        const uint64_t bits0 = CounterRng::keyedBits(key, draw + 0);
+        const uint64_t bits1 = CounterRng::keyedBits(key, draw + 1);
+        const int group = spec.groupsPerType > 1 ? static_cast<int>((index / typeCount) % spec.groupsPerType) : 0;
+
+        switch (spec.layout) {
+        case SpawnLayout::UNIFORM:
+            x = xRange.at(bits0);
+            y = yRange.at(bits1);
+            break;
+        case SpawnLayout::CLUSTERED: {
+            // Box-Muller: two normal offsets from two uniform draws
+            float radius = spread * std::sqrt(-2.0f * std::log(1.0f - CounterRng::unit(bits0)));
+            float angle = twoPi * CounterRng::unit(bits1);
+            const float* center = &centers[2 * (t * spec.groupsPerType + group)];
+            x = std::max(margin, std::min(boxWidth - margin, center[0] + radius * std::cos(angle)));
+            y = std::max(margin, std::min(boxHeight - margin, center[1] + radius * std::sin(angle)));
+            break;
+        }
+        case SpawnLayout::STRIPES: {
+            int stripe = group * typeCount + t;
+            x = std::min(margin + (stripe + CounterRng::unit(bits0)) * stripeWidth, xRange.top);
+            y = yRange.at(bits1);
+            break;
+        }
+        }
+
+        const uint64_t bits2 = CounterRng::keyedBits(key, draw + 2);
+        if (spec.velocity == VelocityDistribution::FIXED_SPEED) {
+            float angle = angleRange.at(bits2);
+            vx = spec.speed * std::cos(angle);
+            vy = spec.speed * std::sin(angle);
+        } else {
+            vx = speedRange.at(bits2);
+            vy = speedRange.at(CounterRng::keyedBits(key, draw + 3));
+        }
+    }
+};
+
+// What the display needs from one generation: the type counts and the
+// agents' positions downsampled to one character per cell. Cells holding
+// several agents show the one with the lowest index.
+struct FrameSnapshot {
+    int generation = 0;
+    int rocks = 0, papers = 0, scissors = 0;
+    float boxWidth = 0.0f, boxHeight = 0.0f;
+    int cols = 0, rows = 0;
+    std::vector<char> cells;    // rows lines of cols characters and a newline
+
+    // Rasterize every agent in one pass, so the cost is O(agents + cells)
+    void rasterize(const AgentStore& agents, int newCols, int newRows) {
+        cols = newCols;
+        rows = newRows;
+        cells.assign(static_cast<size_t>(cols + 1) * rows, '.');
+        for (int y = 0; y < rows; y++) cells[static_cast<size_t>(y) * (cols + 1) + cols] = '\n';
+
+        // Walk backwards so the lowest index is written last and wins its cell
+        for (size_t i = agents.size(); i-- > 0;) {
+            int cellX = static_cast<int>(agents.x[i] * cols / boxWidth);
+            int cellY = static_cast<int>(agents.y[i] * rows / boxHeight);
+            if (cellX < 0 || cellX >= cols || cellY < 0 || cellY >= rows) continue;
+            cells[static_cast<size_t>(cellY) * (cols + 1) + cellX] =
+                typeToSymbol(static_cast<ObjectType>(agents.type[i]));
+        }
+    }
+};
+
+// Draws snapshots as a grid of characters, each frame in a single write.
+// With redraw in place, each frame moves the cursor home with ANSI codes
+// and overwrites the last one instead of scrolling.
+class AsciiRenderer {
+private:
+    int cols, rows;
+    bool redrawInPlace;
+    bool firstFrame = true;
+    std::string frame;
+
+public:
+    AsciiRenderer(int cols = 40, int rows = 20, bool redrawInPlace = false)
+        : cols(std::max(1, cols)), rows(std::max(1, rows)), redrawInPlace(redrawInPlace) {}
+
+    void setResolution(int newCols, int newRows) {
+        cols = std::max(1, newCols);
+        rows = std::max(1, newRows);
+    }
+
+    void setRedrawInPlace(bool enabled) {
+        redrawInPlace = enabled;
+        firstFrame = true;
+    }
+
+    int getCols() const { return cols; }
+    int getRows() const { return rows; }
+
+    void draw(const FrameSnapshot& snapshot, std::ostream& out) {
+        std::ostringstream header;
+        header << "\n" << std::string(50, '=') << "\n";
+        header << "Generation: " << snapshot.generation << "\n";
+        header << "Rocks: " << snapshot.rocks << " | Papers: " << snapshot.papers
+               << " | Scissors: " << snapshot.scissors << "\n";
+        header << "\nSimulation Box (" << snapshot.boxWidth << "x" << snapshot.boxHeight << "):\n";
+
+        frame.clear();
+        if (redrawInPlace) {
+            frame += firstFrame ? "\x1b[2J\x1b[H" : "\x1b[H";
+            firstFrame = false;
+            // Clear the rest of each header line in case the last one was longer
+            for (char c : header.str()) {
+                if (c == '\n') frame += "\x1b[K";
+                frame += c;
+            }
+        } else {
+            frame += header.str();
+        }
+        frame.append(snapshot.cells.begin(), snapshot.cells.end());
+        out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+        out.flush();
+    }
+};
+
+// Read-only view of a whole file. On POSIX systems the file is mapped, so
+// only the pages actually used are read in; elsewhere it is read into
+// memory. Throws std::runtime_error if the file cannot be read.
+class MappedFile {
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+    std::vector<uint8_t> fallback;
+
+public:
+    explicit MappedFile(const std::string& path) {
+#if defined(RPS_POSIX_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path);
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot read " + path);
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            bytes = static_cast<const uint8_t*>(mapped);
+        }
+        ::close(fd);
+#else
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) throw std::runtime_error("cannot open " + path);
+        uint8_t buffer[1 << 16];
+        for (size_t got; (got = std::fread(buffer, 1, sizeof(buffer), file)) > 0;) {
+            fallback.insert(fallback.end(), buffer, buffer + got);
+        }
+        std::fclose(file);
+        bytes = fallback.data();
+        length = fallback.size();
+#endif
+    }
+
+    ~MappedFile() {
+#if defined(RPS_POSIX_MMAP)
+        if (bytes) ::munmap(const_cast<uint8_t*>(bytes), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+// Checkpoint files hold everything a simulator needs to carry on exactly
+// where it stopped: a CheckpointHeader, then the agent arrays x, y, vx, vy,
+// radii (only with per-agent radii), type and ids (only once the agents
+// have been reordered), each starting on a 64-byte boundary so a restore
+// is one bulk copy per array out of the mapping.
+struct CheckpointHeader {
+    char magic[4];
+    uint32_t version;
+    float boxWidth, boxHeight;
+    float radius;
+    uint32_t perAgentRadii;
+    uint64_t seed;
+    uint64_t initCount;
+    int64_t generation;
+    uint64_t agentCount;
+    uint32_t hasAgentIds;
+    uint32_t spatialReorder;
+    int32_t reorderInterval;
+    int32_t reorderCountdown;
+};
+static_assert(sizeof(CheckpointHeader) == 72, "checkpoint header must not be padded");
+
+constexpr char checkpointMagic[4] = {'R', 'P', 'S', 'C'};
+constexpr uint32_t checkpointVersion = 2;
+constexpr size_t checkpointAlignment = 64;
+
+// A copy of a simulator's state, taken by RPSSimulator::captureCheckpoint
+struct SimulatorCheckpoint {
+    CheckpointHeader header;
+    std::vector<float> x, y, vx, vy, radii;
+    std::vector<uint8_t> type;
+    std::vector<uint32_t> ids;
+
+    static size_t aligned(size_t offset) {
+        return (offset + checkpointAlignment - 1) / checkpointAlignment * checkpointAlignment;
+    }
+
+    // Offsets of each array in the file, in file order: x, y, vx, vy, radii, type, ids, end
+    static std::vector<size_t> layout(const CheckpointHeader& h) {
+        size_t floats = static_cast<size_t>(h.agentCount) * sizeof(float);
+        std::vector<size_t> offsets{aligned(sizeof(CheckpointHeader))};
+        for (int a = 0; a < 4; a++) offsets.push_back(aligned(offsets.back() + floats));
+        offsets.push_back(aligned(offsets.back() + (h.perAgentRadii ? floats : 0)));
+        offsets.push_back(offsets.back() + static_cast<size_t>(h.agentCount));
+        if (h.hasAgentIds) offsets.back() = aligned(offsets.back());
+        size_t ids = h.hasAgentIds ? static_cast<size_t>(h.agentCount) * sizeof(uint32_t) : 0;
+        offsets.push_back(offsets.back() + ids);
+        return offsets;
+    }
+
+    // Write to path atomically: a crash mid-write leaves any previous
+    // checkpoint at path intact. Throws std::runtime_error on failure.
+    void write(const std::string& path) const {
+        std::string partial = path + ".partial";
+        std::FILE* file = std::fopen(partial.c_str(), "wb");
+        if (!file) throw std::runtime_error("cannot create checkpoint " + partial);
+
+        std::vector<size_t> offsets = layout(header);
+        const void* arrays[] = {x.data(), y.data(), vx.data(), vy.data(), radii.data(), type.data(), ids.data()};
+        const size_t floats = static_cast<size_t>(header.agentCount) * sizeof(float);
+        const size_t sizes[] = {floats, floats, floats, floats, header.perAgentRadii ? floats : 0,
+                                static_cast<size_t>(header.agentCount),
+                                header.hasAgentIds ? static_cast<size_t>(header.agentCount) * sizeof(uint32_t) : 0};
+        static const char zeros[checkpointAlignment] = {};
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        size_t written = sizeof(header);
+        for (size_t a = 0; a < 7 && ok; a++) {
+            size_t padding = offsets[a] - written;
+            ok = std::fwrite(zeros, 1, padding, file) == padding &&
+                 std::fwrite(arrays[a], 1, sizes[a], file) == sizes[a];
+            written = offsets[a] + sizes[a];
+        }
+        ok = std::fclose(file) == 0 && ok;
+        if (!ok || std::rename(partial.c_str(), path.c_str()) != 0) {
+            std::remove(partial.c_str());
+            throw std::runtime_error("error writing checkpoint " + path);
+        }
+    }
+};
+
+// The estimate behind estimateRemainingGenerations for a decided game,
+// from the winners' count and speeds and radii summed over all agents
+inline double remainingGenerationsEstimate(double winners, double total, double speedSquared, double radiusSum,
+                                           float boxWidth, float boxHeight) {
+    double losers = total - winners;
+    double relativeSpeed = std::sqrt(2.0 * speedSquared / total);
+    double k = 4.0 * (radiusSum / total) * relativeSpeed / (static_cast<double>(boxWidth) * boxHeight);
+    if (k <= 0.0) return std::numeric_limits<double>::infinity();
+    return std::max(0.0, std::log(losers / winners * (total - 1.0)) / (k * total));
+}
+
+// Simulation of a rule set such as ClassicRules. Each rule set gets its
+// own instance, so winner lookups and per-type counts are sized and
+// resolved at compile time; RPSSimulator is the three-type game.
+template <typename RuleSet>
+class BasicRPSSimulator {
+public:
+    static constexpr int typeCount = RuleSet::typeCount;
+
+private:
+    using GameRules = BasicGameRules<RuleSet>;
+
+    AgentStore agents;
+    float boxWidth, boxHeight;
+    CounterRng rng;
+    uint64_t initCount = 0;          // initializeObjects calls so far; keeps each call's draws distinct
+    int generation;
+    float timestep = 1.0f;
+    bool sweptCollisions = false;
+    bool inertSleeping = false;
+    SpawnSpec spawn;                 // Layout initializeObjects uses
+    int typeCounts[typeCount] = {};  // Population of each type, kept current by resolveCollision
+    mutable AsciiRenderer renderer;  // Reuses its buffers across displayState calls
+    mutable FrameSnapshot displaySnapshot;
+    ConversionLog* conversionLog = nullptr;
+    std::vector<ConversionEvent> groupEvents;
+    ScratchArena arena;              // Scratch arrays for one generation, reset by update()
+    GenerationStats stats;           // Profile of the last update(), see GenerationStats
+    PairCounters pairCounters;       // Serial collision work this generation
+    uint64_t conversionTotal = 0;    // Conversions resolved since construction
+    StatsFeed* statsFeed = nullptr;
+    mutable std::vector<int> sampleCells;    // Per-type counts of each clustering cell
+
+    // Broad-phase state, reused across generations
+    SpatialGrid grid;
+    std::vector<int> candidates;
+    std::vector<float> drift;        // Separation applied to each agent since it was binned
+    std::vector<uint8_t> asleep;     // Agents left out of this generation's collisions; empty if none
+    size_t asleepCount = 0;
+
+    // Spatial reordering; see reorderAgents
+    static constexpr int maxReorderInterval = 64;    // Generations
+    bool spatialReorder = false;
+    int reorderInterval = 1;
+    int reorderCountdown = 1;        // Generations until the next reorder check
+    std::vector<uint32_t> agentIds;  // Id of the agent in each slot; empty while every slot is its own id
+    std::vector<float> reorderFloats;
+    std::vector<uint8_t> reorderTypes;
+    std::vector<uint32_t> reorderIds;
+
+    // Parallel update state. A group is a set of agents whose collisions are
+    // resolved together; see resolveCollisionsParallel.
+    struct CollisionGroup {
+        std::vector<int> members;           // Ascending agent indices
+        std::vector<HitRecord> history;     // Positions after each hit, in resolution order
+        float minX, minY, maxX, maxY;       // Bounds of the members' start positions
+        int typeDelta[typeCount];           // Population change from resolving the group
+        PairCounters pairs;                 // Collisions found resolving the group
+        ConversionLog events;               // Conversions, if the simulator is logging them
+    };
+    struct WorkerScratch {
+        SpatialGrid grid;
+        std::vector<int> candidates;
+        std::vector<std::pair<int, int>> links;    // Group pairs found to interact
+        PairCounters pairs;                        // Pairs tested while linking
+    };
+    static constexpr size_t minParallelAgents = 2048;  // Below this the serial path is faster
+    static constexpr int maxMergeRounds = 16;
+    static constexpr int maxParallelBackoff = 64;    // Generations
+    int parallelBackoff = 0;
+    int serialGenerationsLeft = 0;
+    double serialSeconds = 0.0;     // Time the last serial resolve took, 0 until measured
+    unsigned threadCount = 1;
+    std::unique_ptr<WorkerPool> pool;
+    std::vector<WorkerScratch> scratch;
+    std::vector<float> startX, startY;
+    std::vector<uint8_t> startType;
+    std::vector<int> groupParent;           // Union-find over agents; a group's root is its lowest agent
+    std::vector<int> groupSlot;             // Index into groups for each root, -1 for singletons
+    std::vector<CollisionGroup> groups;
+    std::vector<int> pendingGroups;
+    std::vector<int> moved;
+    std::vector<int> mergedRoots;
+    std::vector<std::pair<int, int>> mergedMembers;
+    std::vector<HitRecord> allHits;
+    std::vector<int> hitStart;              // Offset of each agent's records in allHits, by agent
+
+#ifdef RPS_COUNT_ALLOCATIONS
+    uint64_t allocationsSoFar() const {
+        return heapAllocationCount + (pool ? pool->helperAllocationCount() : 0);
+    }
+
+    // Bytes held by every buffer update() reuses across generations
+    size_t scratchFootprint() const {
+        auto bytes = [](const auto& v) { return v.capacity() * sizeof(*v.data()); };
+        size_t total = arena.bytesReserved() + grid.capacityBytes() + bytes(candidates) + bytes(drift) +
+                       bytes(groupEvents) + bytes(startX) + bytes(startY) + bytes(startType) + bytes(startVX) +
+                       bytes(startVY) + bytes(sweptContacts) + bytes(groupParent) + bytes(groupSlot) +
+                       bytes(groups) + bytes(pendingGroups) + bytes(moved) + bytes(mergedRoots) +
+                       bytes(mergedMembers) + bytes(allHits) + bytes(hitStart) + bytes(agentIds) +
+                       bytes(reorderFloats) + bytes(reorderTypes) + bytes(reorderIds) + bytes(sampleCells) +
+                       bytes(asleep);
+        for (const auto& group : groups) {
+            total += bytes(group.members) + bytes(group.history) + bytes(group.events.buffered());
+        }
+        for (const auto& s : scratch) {
+            total += s.grid.capacityBytes() + bytes(s.candidates) + bytes(s.links);
+        }
+        if (conversionLog) total += bytes(conversionLog->buffered());
+        return total;
+    }
+#endif
+
+    bool useParallel() const {
+        return pool && agents.size() >= minParallelAgents;
+    }
+
+    uint32_t agentId(size_t slot) const {
+        return agentIds.empty() ? static_cast<uint32_t>(slot) : agentIds[slot];
+    }
+
+    // Sort the agent arrays along a Morton curve over collision-sized cells,
+    // so agents close in the box are close in memory and the pair scan
+    // stays in cache. Agents keep their ids; only their slots change.
+    //
+    // The sort is adaptive. A check runs every reorderInterval generations,
+    // and the interval doubles while few agents have changed cell since the
+    // last sort and halves when many have, so sorting keeps pace with how
+    // fast agents actually drift. The arrays are sorted from last time, so
+    // only the agents now out of order are pulled out, sorted and merged
+    // back in, costing O(n + m log m) for m movers.
+    void reorderAgents() {
+        if (!spatialReorder || --reorderCountdown > 0) return;
+        const size_t n = agents.size();
+        PhaseTimer timer(stats, GenerationStats::REORDER);
+
+        // Keys are the Morton code above the slot, so equal cells keep their order
+        float cell = std::max({2.0f * agents.maxRadius() + 2.0f * collisionSlack(), boxWidth / 65536.0f,
+                               boxHeight / 65536.0f});
+        auto cellCoord = [&](float v) {
+            return static_cast<uint32_t>(std::max(0, std::min(65535, static_cast<int>(v / cell))));
+        };
+        uint64_t* keys = arena.allocate<uint64_t>(n);
+        size_t outOfOrder = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t code = mortonCode(cellCoord(agents.x[i]), cellCoord(agents.y[i]));
+            keys[i] = code << 32 | i;
+            if (i > 0 && keys[i] < keys[i - 1]) outOfOrder++;
+        }
+
+        if (outOfOrder <= n / 256) {
+            reorderInterval = std::min(maxReorderInterval, 2 * reorderInterval);
+        } else if (outOfOrder > n / 16) {
+            reorderInterval = std::max(1, reorderInterval / 2);
+        }
+        reorderCountdown = reorderInterval;
+        if (outOfOrder == 0) return;
+
+        // Keep the ascending run and set aside everything that breaks it
+        uint64_t* movers = arena.allocate<uint64_t>(n);
+        size_t kept = 0, moverCount = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (kept == 0 || keys[i] > keys[kept - 1]) {
+                keys[kept++] = keys[i];
+            } else {
+                movers[moverCount++] = keys[i];
+            }
+        }
+        std::sort(movers, movers + moverCount);
+        uint64_t* order = arena.allocate<uint64_t>(n);
+        std::merge(keys, keys + kept, movers, movers + moverCount, order);
+
+        if (agentIds.empty()) {
+            agentIds.resize(n);
+            for (size_t i = 0; i < n; i++) agentIds[i] = static_cast<uint32_t>(i);
+        }
+        auto gather = [&](auto& values, auto& spare) {
+            spare.resize(n);
+            for (size_t k = 0; k < n; k++) spare[k] = values[static_cast<uint32_t>(order[k])];
+            values.swap(spare);
+        };
+        gather(agents.x, reorderFloats);
+        gather(agents.y, reorderFloats);
+        gather(agents.vx, reorderFloats);
+        gather(agents.vy, reorderFloats);
+        if (agents.hasPerAgentRadii()) gather(agents.radii, reorderFloats);
+        gather(agents.type, reorderTypes);
+        gather(agentIds, reorderIds);
+    }
+
+    void timedMove() {
+        {
+            PhaseTimer timer(stats, GenerationStats::MOVE);
+            moveAgents();
+        }
+        PhaseTimer timer(stats, GenerationStats::BOUNDARIES);
+        handleBoundaries();
+    }
+
+    void moveAgents() {
+        if (timestep != 1.0f) {
+            forEachChunk([&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    agents.x[i] += agents.vx[i] * timestep;
+                    agents.y[i] += agents.vy[i] * timestep;
+                }
+            });
+            return;
+        }
+        const MoveKernels& kernels = MoveKernels::active();
+        forEachChunk([&](size_t begin, size_t end) {
+            kernels.integrate(agents.x.data() + begin, agents.vx.data() + begin, end - begin);
+            kernels.integrate(agents.y.data() + begin, agents.vy.data() + begin, end - begin);
+        });
+    }
+
+    void handleBoundaries() {
+        const MoveKernels& kernels = MoveKernels::active();
+        bool perAgent = agents.hasPerAgentRadii();
+        forEachChunk([&](size_t begin, size_t end) {
+            const float* radii = perAgent ? agents.radii.data() + begin : nullptr;
+            kernels.reflect(agents.x.data() + begin, agents.vx.data() + begin, radii, agents.radius,
+                            end - begin, boxWidth);
+            kernels.reflect(agents.y.data() + begin, agents.vy.data() + begin, radii, agents.radius,
+                            end - begin, boxHeight);
+        });
+    }
+
+    // Run fn(begin, end) over contiguous agent ranges, on the pool if enabled
+    template <typename Fn>
+    void forEachChunk(Fn fn) {
+        size_t n = agents.size();
+        if (!useParallel()) {
+            fn(0, n);
+            return;
+        }
+        const size_t chunk = 16384;
+        pool->run((n + chunk - 1) / chunk, [&](size_t task, unsigned) {
+            fn(task * chunk, std::min(n, (task + 1) * chunk));
+        });
+    }
+
+    float collisionSlack() const { return agents.maxRadius(); }
+
+    // Swept collisions. Before the move, every neighbouring pair is solved
+    // for the first time in [0, timestep] at which the two circles touch.
+    // Contacts are then resolved in time-of-impact order, ties broken by
+    // agent index, so a conversion early in the step decides what later
+    // contacts in the same step do. Each push-apart is computed at the
+    // contact positions and added to the agents' end-of-step positions.
+    // Separations are not fed back into later impact times.
+    struct SweptContact {
+        float time;
+        int a, b;
+    };
+    std::vector<SweptContact> sweptContacts;
+    std::vector<float> startVX, startVY;
+
+    void findSweptContacts() {
+        sweptContacts.clear();
+        const size_t n = agents.size();
+        if (n == 0) return;
+        startX = agents.x;
+        startY = agents.y;
+        startVX = agents.vx;
+        startVY = agents.vy;
+
+        // Cells cover the contact distance plus how far two agents can close in on each other
+        float maxSpeed = 0.0f;
+        for (size_t i = 0; i < n; i++) {
+            maxSpeed = std::max(maxSpeed, agents.vx[i] * agents.vx[i] + agents.vy[i] * agents.vy[i]);
+        }
+        float reach = 2.0f * std::sqrt(maxSpeed) * timestep;
+        float minX = 0.0f, minY = 0.0f, maxX = boxWidth, maxY = boxHeight;
+        for (size_t i = 0; i < n; i++) {
+            minX = std::min(minX, agents.x[i]);
+            maxX = std::max(maxX, agents.x[i]);
+            minY = std::min(minY, agents.y[i]);
+            maxY = std::max(maxY, agents.y[i]);
+        }
+        grid.build(agents, nullptr, n, minX, minY, maxX, maxY, 2.0f * agents.maxRadius() + reach);
+
+        const bool perAgent = agents.hasPerAgentRadii();
+        for (size_t i = 0; i < n; i++) {
+            grid.query(agents.x[i], agents.y[i], static_cast<int>(i), candidates);
+            pairCounters.test(candidates.size());
+            for (int j : candidates) {
+                float dx = agents.x[i] - agents.x[j], dy = agents.y[i] - agents.y[j];
+                float wx = agents.vx[i] - agents.vx[j], wy = agents.vy[i] - agents.vy[j];
+                float contact = perAgent ? agents.radii[i] + agents.radii[j] : 2.0f * agents.radius;
+
+                // |d + w t| = contact, taking the first root
+                float c = dx * dx + dy * dy - contact * contact;
+                float time;
+                if (c <= 0.0f) {
+                    time = 0.0f;
+                } else {
+                    float a = wx * wx + wy * wy;
+                    float b = dx * wx + dy * wy;
+                    float disc = b * b - a * c;
+                    if (a == 0.0f || b >= 0.0f || disc < 0.0f) continue;   // Not approaching, or missing
+                    time = (-b - std::sqrt(disc)) / a;
+                    if (time > timestep) continue;
+                }
+                sweptContacts.push_back({time, static_cast<int>(i), j});
+            }
+        }
+        std::sort(sweptContacts.begin(), sweptContacts.end(), [](const SweptContact& l, const SweptContact& r) {
+            if (l.time != r.time) return l.time < r.time;
+            return l.a != r.a ? l.a < r.a : l.b < r.b;
+        });
+    }
+
+    void resolveSweptContacts() {
+        if (conversionLog) conversionLog->setGeneration(static_cast<uint32_t>(generation + 1));
+        for (const SweptContact& contact : sweptContacts) {
+            int a = contact.a, b = contact.b;
+            float ax = startX[a] + startVX[a] * contact.time, ay = startY[a] + startVY[a] * contact.time;
+            float bx = startX[b] + startVX[b] * contact.time, by = startY[b] + startVY[b] * contact.time;
+            float avx = startVX[a], avy = startVY[a], bvx = startVX[b], bvy = startVY[b];
+            float ar = agents.hasPerAgentRadii() ? agents.radii[a] : agents.radius;
+            float br = agents.hasPerAgentRadii() ? agents.radii[b] : agents.radius;
+            float ax0 = ax, ay0 = ay, bx0 = bx, by0 = by;
+
+            GameObject obj1(agents.type[a], ax, ay, avx, avy, ar);
+            GameObject obj2(agents.type[b], bx, by, bvx, bvy, br);
+            pairCounters.collide(obj1.type != obj2.type);
+            GameRules::resolveCollision(obj1, obj2, typeCounts, conversionLog, agentId(a), agentId(b));
+            agents.x[a] += ax - ax0;
+            agents.y[a] += ay - ay0;
+            agents.x[b] += bx - bx0;
+            agents.y[b] += by - by0;
+        }
+    }
+
+    void resolveCollisions() {
+        if (agents.empty()) return;
+
+        float slack = collisionSlack();
+        {
+            PhaseTimer timer(stats, GenerationStats::DETECTION);
+            float cellSize = 2.0f * agents.maxRadius() + 2.0f * slack;
+            asleepCount = inertSleeping
+                ? grid.markInert(agents, agents.size(), 0.0f, 0.0f, boxWidth, boxHeight, cellSize, asleep) : 0;
+            if (asleepCount == 0) asleep.clear();
+            grid.build(agents, nullptr, agents.size(), 0.0f, 0.0f, boxWidth, boxHeight, cellSize,
+                       asleep.empty() ? nullptr : asleep.data());
+        }
+        PhaseTimer timer(stats, GenerationStats::RESOLUTION);
+        drift.assign(agents.size(), 0.0f);
+        if (conversionLog) conversionLog->setGeneration(static_cast<uint32_t>(generation + 1));
+
+        auto start = std::chrono::steady_clock::now();
+        auto elapsed = [&] {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        if (useParallel() && serialGenerationsLeft == 0) {
+            // Both paths give the same result, so keep speculating only
+            // while it beats the serial scan. In crowded worlds validation
+            // and re-resolving can cost far more than they save.
+            bool settled = resolveCollisionsParallel();
+            if (settled && (serialSeconds == 0.0 || elapsed() < serialSeconds)) {
+                parallelBackoff = 0;
+                if (serialSeconds == 0.0) serialGenerationsLeft = 1;  // Measure serial once to compare
+            } else {
+                parallelBackoff = std::min(maxParallelBackoff, std::max(1, 2 * parallelBackoff));
+                serialGenerationsLeft = parallelBackoff;
+            }
+        } else {
+            if (serialGenerationsLeft > 0) serialGenerationsLeft--;
+            resolveGroup(grid, candidates, nullptr, agents.size(), nullptr, typeCounts, conversionLog, false,
+                         pairCounters);
+            serialSeconds = elapsed();
+        }
+    }
+
+    // Resolve collisions among a set of agents in the same order as a full
+    // i < j pair scan over that set, but only test pairs the grid reports as
+    // neighbours. grid must already hold the set; members lists it in
+    // ascending order, or is null for every agent. If history is set, the
+    // position of each agent after every hit is appended to it. Conversions
+    // are applied to counts and, if log is set, pushed to it by agent id, or
+    // by slot with logSlots so logGroupEvents can order them. The work is
+    // tallied in pairs.
+    //
+    // Cells are sized to cover the collision distance plus a slack band.
+    // Separation nudges move agents while a generation is resolved, so an
+    // agent whose accumulated nudge exceeds the band is re-binned, and a
+    // row's candidates are re-queried once agent i itself has moved that
+    // far. This keeps every pair the full scan would hit in the candidate
+    // set, so outcomes match the O(n^2) loop exactly.
+    void resolveGroup(SpatialGrid& groupGrid, std::vector<int>& rowCandidates,
+                      const int* members, size_t count, std::vector<HitRecord>* history,
+                      int* counts, ConversionLog* log, bool logSlots, PairCounters& pairs) {
+        float rebinDistance = 0.75f * collisionSlack();  // Leaves headroom for rounding in the nudges
+        const NarrowPhaseKernels& narrowPhase = NarrowPhaseKernels::active();
+        const uint64_t n = agents.size();
+
+        // The narrow phase takes agent indices, so map slots back to agents
+        auto toAgents = [&](std::vector<int>& slots) {
+            if (!members) return;
+            for (int& s : slots) s = members[s];
+        };
+        auto slotOf = [&](int agent, int fromSlot) {
+            if (!members) return agent;
+            return static_cast<int>(std::lower_bound(members + fromSlot, members + count, agent) - members);
+        };
+
+        const bool sleeping = !members && !asleep.empty();    // Groups never hold sleeping agents
+        for (size_t row = 0; row < count; row++) {
+            size_t i = members ? members[row] : row;
+            if (sleeping && asleep[i]) continue;
+            GameObject obj1 = agents[i];
+            groupGrid.query(obj1.x, obj1.y, static_cast<int>(row), rowCandidates);
+            toAgents(rowCandidates);
+
+            // Agent i moves whenever it is separated from a hit, so the
+            // remaining candidates are re-tested from its new position
+            float rowDrift = 0.0f;
+            for (size_t c = 0; c < rowCandidates.size();) {
+                int hit;
+                size_t remaining = rowCandidates.size() - c;
+                if (narrowPhase.collectHits(agents, i, rowCandidates.data() + c, remaining, &hit, 1) == 0) {
+                    pairs.test(remaining);
+                    break;
+                }
+                pairs.test(hit + 1);
+                c += hit;
+                int j = rowCandidates[c++];
+                GameObject obj2 = agents[j];
+                pairs.collide(obj1.type != obj2.type);
+
+                GameRules::resolveCollision(obj1, obj2, counts, log,
+                                            logSlots ? static_cast<uint32_t>(i) : agentId(i),
+                                            logSlots ? static_cast<uint32_t>(j) : agentId(j));
+
+                if (history) {
+                    uint64_t key = i * n + j;
+                    history->push_back({key, static_cast<int>(i), obj1.x, obj1.y});
+                    history->push_back({key, j, obj2.x, obj2.y});
+                }
+
+                drift[j] += GameRules::separationForce;
+                if (drift[j] > rebinDistance) {
+                    groupGrid.rebin(slotOf(j, static_cast<int>(row)), obj2.x, obj2.y);
+                    drift[j] = 0.0f;
+                }
+
+                rowDrift += GameRules::separationForce;
+                if (rowDrift > rebinDistance) {
+                    // Agent i has moved far from where its candidates were gathered
+                    groupGrid.query(obj1.x, obj1.y, slotOf(j, static_cast<int>(row)), rowCandidates);
+                    toAgents(rowCandidates);
+                    rowDrift = 0.0f;
+                    c = 0;
+                }
+            }
+        }
+    }
+
+    // Recount every type from the agents; update() keeps the counts current
+    // after this
+    void countTypes() {
+        std::fill(typeCounts, typeCounts + typeCount, 0);
+        for (uint8_t t : agents.type) typeCounts[t]++;
+    }
+
+    int findGroup(int g) {
+        while (groupParent[g] != g) {
+            groupParent[g] = groupParent[groupParent[g]];
+            g = groupParent[g];
+        }
+        return g;
+    }
+
+    // Parallel collision resolution that gives bit-identical results to the
+    // serial path.
+    //
+    // Agents touching at their start positions are linked into groups.
+    // Groups are spread over spatial tiles, and each tile resolves its
+    // groups independently, in serial pair order within a group, while
+    // recording where every agent was after each of its hits. A validation
+    // pass then replays every cross-group pair involving a moved agent at
+    // the point the serial scan would test it. Groups that would have
+    // touched are merged and re-resolved from their start state in a
+    // second pass, and the check repeats. Once no cross-group pair touches,
+    // no group could have affected another, so the result equals the
+    // serial scan exactly. If merging does not settle, the generation is
+    // redone serially and false is returned.
+    bool resolveCollisionsParallel() {
+        const size_t n = agents.size();
+        startX = agents.x;
+        startY = agents.y;
+        startType = agents.type;
+
+        // Link agents touching at their start positions
+        for (auto& s : scratch) {
+            s.links.clear();
+            s.pairs.clear();
+        }
+        const size_t chunk = 4096;
+        const size_t chunks = (n + chunk - 1) / chunk;
+        pool->run(chunks, [&](size_t task, unsigned worker) {
+            WorkerScratch& s = scratch[worker];
+            for (size_t i = task * chunk; i < std::min(n, (task + 1) * chunk); i++) {
+                if (!asleep.empty() && asleep[i]) continue;
+                grid.query(agents.x[i], agents.y[i], static_cast<int>(i), s.candidates);
+                s.pairs.test(s.candidates.size());
+                for (int j : s.candidates) {
+                    if (agentsTouch(agents, i, j)) s.links.emplace_back(static_cast<int>(i), j);
+                }
+            }
+        });
+
+        groupParent.resize(n);
+        for (size_t i = 0; i < n; i++) groupParent[i] = static_cast<int>(i);
+        for (const auto& s : scratch) {
+            for (const auto& link : s.links) {
+                int a = findGroup(link.first), b = findGroup(link.second);
+                if (a != b) groupParent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+
+        // Each group is named by its lowest agent. Only groups with pairs
+        // to resolve get a CollisionGroup; groupSlot maps a root to it.
+        groupSlot.assign(n, -1);
+        size_t groupCount = 0;
+        for (size_t i = 0; i < n; i++) {
+            int root = findGroup(static_cast<int>(i));
+            if (root == static_cast<int>(i)) continue;
+            if (groupSlot[root] < 0) {
+                if (groups.size() <= groupCount) groups.resize(groupCount + 1);
+                groups[groupCount].members.assign(1, root);
+                groupSlot[root] = static_cast<int>(groupCount++);
+            }
+            groups[groupSlot[root]].members.push_back(static_cast<int>(i));
+        }
+
+        pendingGroups.clear();
+        for (size_t g = 0; g < groupCount; g++) {
+            pendingGroups.push_back(static_cast<int>(g));
+        }
+
+        for (int round = 0; round <= maxMergeRounds; round++) {
+            resolvePendingGroups(round > 0);
+
+            // Index every agent's hit positions for validation, grouped by agent
+            // by counting sort, which keeps each agent's hits in resolution order
+            hitStart.assign(n + 1, 0);
+            for (size_t g = 0; g < groupCount; g++) {
+                if (groups[g].members.empty()) continue;
+                for (const auto& h : groups[g].history) hitStart[h.agent + 1]++;
+            }
+            for (size_t i = 0; i < n; i++) hitStart[i + 1] += hitStart[i];
+            int* hitFill = arena.allocate<int>(n);
+            std::copy(hitStart.begin(), hitStart.end() - 1, hitFill);
+            allHits.resize(hitStart[n]);
+            for (size_t g = 0; g < groupCount; g++) {
+                if (groups[g].members.empty()) continue;
+                for (const auto& h : groups[g].history) allHits[hitFill[h.agent]++] = h;
+            }
+
+            // First round: every moved agent checks partners that moved no
+            // further than itself, which covers every pair from one side.
+            // Later rounds: only re-resolved groups changed, so their members
+            // check partners out to the largest move of any agent.
+            for (auto& s : scratch) s.links.clear();
+            moved.clear();
+            float maxReach = 0.0f;
+            for (size_t i = 0; i < n; i++) {
+                maxReach = std::max(maxReach, moveReach(static_cast<int>(i)));
+            }
+            if (round == 0) {
+                for (size_t i = 0; i < n; i++) {
+                    if (hitStart[i + 1] > hitStart[i]) moved.push_back(static_cast<int>(i));
+                }
+            } else {
+                for (int g : pendingGroups) {
+                    moved.insert(moved.end(), groups[g].members.begin(), groups[g].members.end());
+                }
+            }
+            pool->run((moved.size() + 255) / 256, [&](size_t task, unsigned worker) {
+                size_t end = std::min(moved.size(), (task + 1) * 256);
+                for (size_t m = task * 256; m < end; m++) {
+                    int agent = moved[m];
+                    validateAgent(agent, round == 0 ? moveReach(agent) : maxReach, scratch[worker]);
+                }
+            });
+
+            if (!mergeLinkedGroups(groupCount)) {
+                // Groups absorbed by a merge are empty; the rest hold their final deltas
+                for (size_t g = 0; g < groupCount; g++) {
+                    if (groups[g].members.empty()) continue;
+                    for (int t = 0; t < typeCount; t++) typeCounts[t] += groups[g].typeDelta[t];
+                }
+                for (size_t g = 0; g < groupCount; g++) {
+                    if (!groups[g].members.empty()) pairCounters.conversions += groups[g].pairs.conversions;
+                }
+#ifdef RPS_PROFILE
+                // Groups re-test pairs the linking pass already tested, so
+                // only their collisions count
+                for (const auto& sc : scratch) pairCounters.tested += sc.pairs.tested;
+                for (size_t g = 0; g < groupCount; g++) {
+                    if (!groups[g].members.empty()) pairCounters.colliding += groups[g].pairs.colliding;
+                }
+#endif
+                if (conversionLog) logGroupEvents(groupCount);
+                return true;
+            }
+
+            // A group this large leaves nothing to overlap; stop speculating
+            size_t largest = 0;
+            for (int g : pendingGroups) largest = std::max(largest, groups[g].members.size());
+            if (largest > n / 2) break;
+        }
+
+        // Merging did not settle; redo the whole generation serially. The
+        // caller backs off from speculating while the world stays this entangled.
+        agents.x = startX;
+        agents.y = startY;
+        agents.type = startType;
+        drift.assign(n, 0.0f);
+        resolveGroup(grid, candidates, nullptr, n, nullptr, typeCounts, conversionLog, false, pairCounters);
+        return false;
+    }
+
+    // Pass the settled groups' conversions to the log in the order the
+    // serial scan would have produced them: by pair, lowest agent first
+    void logGroupEvents(size_t groupCount) {
+        groupEvents.clear();
+        for (size_t g = 0; g < groupCount; g++) {
+            if (groups[g].members.empty()) continue;
+            std::vector<ConversionEvent>& events = groups[g].events.buffered();
+            groupEvents.insert(groupEvents.end(), events.begin(), events.end());
+        }
+
+        // Sort (pair, position) keys in the arena; the position keeps a
+        // pair's events in the order they happened without a stable sort
+        struct EventKey {
+            uint64_t pair;
+            uint32_t index;
+        };
+        const uint64_t n = agents.size();
+        EventKey* order = arena.allocate<EventKey>(groupEvents.size());
+        for (size_t k = 0; k < groupEvents.size(); k++) {
+            const ConversionEvent& e = groupEvents[k];
+            order[k] = {static_cast<uint64_t>(std::min(e.agent, e.converter)) * n + std::max(e.agent, e.converter),
+                        static_cast<uint32_t>(k)};
+        }
+        std::sort(order, order + groupEvents.size(), [](const EventKey& a, const EventKey& b) {
+            return a.pair != b.pair ? a.pair < b.pair : a.index < b.index;
+        });
+        for (size_t k = 0; k < groupEvents.size(); k++) {
+            const ConversionEvent& e = groupEvents[order[k].index];
+            conversionLog->push(agentId(e.agent), agentId(e.converter), static_cast<ObjectType>(e.fromType),
+                                static_cast<ObjectType>(e.toType));
+        }
+    }
+
+    // Resolve every pending group on the pool, restoring the members'
+    // start state first when they were resolved in an earlier round
+    void resolvePendingGroups(bool restore) {
+        float minCellSize = 2.0f * agents.maxRadius() + 2.0f * collisionSlack();
+
+        for (int g : pendingGroups) {
+            CollisionGroup& group = groups[g];
+            group.minX = group.minY = std::numeric_limits<float>::max();
+            group.maxX = group.maxY = std::numeric_limits<float>::lowest();
+            for (int a : group.members) {
+                group.minX = std::min(group.minX, startX[a]);
+                group.maxX = std::max(group.maxX, startX[a]);
+                group.minY = std::min(group.minY, startY[a]);
+                group.maxY = std::max(group.maxY, startY[a]);
+            }
+        }
+
+        // Tiles give each worker a spatially coherent batch of groups;
+        // a group belongs to the tile holding its lowest agent. Groups are
+        // counting-sorted by tile into arena arrays.
+        unsigned tilesPerSide = static_cast<unsigned>(std::ceil(std::sqrt(4.0 * pool->size())));
+        size_t tileCount = static_cast<size_t>(tilesPerSide) * tilesPerSide;
+        auto tileOf = [&](int g) {
+            int lead = groups[g].members.front();
+            size_t tx = std::min<size_t>(tilesPerSide - 1, static_cast<size_t>(std::max(0.0f, startX[lead]) / boxWidth * tilesPerSide));
+            size_t ty = std::min<size_t>(tilesPerSide - 1, static_cast<size_t>(std::max(0.0f, startY[lead]) / boxHeight * tilesPerSide));
+            return ty * tilesPerSide + tx;
+        };
+        int* tileStart = arena.allocate<int>(tileCount + 1);
+        int* tileFill = arena.allocate<int>(tileCount);
+        int* tileGroups = arena.allocate<int>(pendingGroups.size());
+        std::fill(tileStart, tileStart + tileCount + 1, 0);
+        for (int g : pendingGroups) tileStart[tileOf(g) + 1]++;
+        for (size_t t = 0; t < tileCount; t++) tileStart[t + 1] += tileStart[t];
+        std::copy(tileStart, tileStart + tileCount, tileFill);
+        for (int g : pendingGroups) tileGroups[tileFill[tileOf(g)]++] = g;
+
+        pool->run(tileCount, [&](size_t tile, unsigned worker) {
+            WorkerScratch& s = scratch[worker];
+            for (int k = tileStart[tile]; k < tileStart[tile + 1]; k++) {
+                CollisionGroup& group = groups[tileGroups[k]];
+                for (int a : group.members) {
+                    if (restore) {
+                        agents.x[a] = startX[a];
+                        agents.y[a] = startY[a];
+                        agents.type[a] = startType[a];
+                    }
+                    drift[a] = 0.0f;
+                }
+                group.history.clear();
+                std::fill(group.typeDelta, group.typeDelta + typeCount, 0);
+                group.pairs.clear();
+                group.events.buffered().clear();
+                s.grid.build(agents, group.members.data(), group.members.size(),
+                             group.minX, group.minY, group.maxX, group.maxY, minCellSize);
+                resolveGroup(s.grid, s.candidates, group.members.data(), group.members.size(),
+                             &group.history, group.typeDelta, conversionLog ? &group.events : nullptr, true,
+                             group.pairs);
+            }
+        });
+    }
+
+    // Position of an agent when the serial scan reaches the pair with the
+    // given key: the last recorded hit before it, or its start position
+    void positionAt(int agent, uint64_t key, float& x, float& y) const {
+        x = startX[agent];
+        y = startY[agent];
+        for (int h = hitStart[agent]; h < hitStart[agent + 1] && allHits[h].key < key; h++) {
+            x = allHits[h].x;
+            y = allHits[h].y;
+        }
+    }
+
+    // Upper bound on how far an agent was pushed by its recorded hits
+    float moveReach(int agent) const {
+        int moves = hitStart[agent + 1] - hitStart[agent];
+        return moves == 0 ? 0.0f : moves * GameRules::separationForce * 1.01f + 1e-3f;
+    }
+
+    // Record a link for every agent of another group, among those that moved
+    // at most partnerReach, which the serial scan would have found touching
+    // `agent`
+    void validateAgent(int agent, float partnerReach, WorkerScratch& s) {
+        const uint64_t n = agents.size();
+        float range = 2.0f * agents.maxRadius() + moveReach(agent) + partnerReach;
+        int group = findGroupConst(agent);
+
+        grid.queryRange(startX[agent], startY[agent], range, s.candidates);
+        for (int other : s.candidates) {
+            if (other == agent || findGroupConst(other) == group) continue;
+
+            int lo = std::min(agent, other), hi = std::max(agent, other);
+            uint64_t key = static_cast<uint64_t>(lo) * n + hi;
+            float ax, ay, bx, by;
+            positionAt(lo, key, ax, ay);
+            positionAt(hi, key, bx, by);
+            float ra = agents.hasPerAgentRadii() ? agents.radii[lo] : agents.radius;
+            float rb = agents.hasPerAgentRadii() ? agents.radii[hi] : agents.radius;
+            if (withinContact(ax - bx, ay - by, ra + rb)) s.links.emplace_back(lo, hi);
+        }
+    }
+
+    // Read-only find for use from worker threads during validation
+    int findGroupConst(int g) const {
+        while (groupParent[g] != g) g = groupParent[g];
+        return g;
+    }
+
+    // Join every pair of groups linked during validation and queue the
+    // joined groups for re-resolving. Returns false if nothing was linked.
+    bool mergeLinkedGroups(size_t& groupCount) {
+        mergedRoots.clear();
+        for (const auto& s : scratch) {
+            for (const auto& link : s.links) {
+                int a = findGroup(link.first), b = findGroup(link.second);
+                if (a == b) continue;
+                mergedRoots.push_back(a);
+                mergedRoots.push_back(b);
+                groupParent[std::max(a, b)] = std::min(a, b);
+            }
+        }
+        if (mergedRoots.empty()) return false;
+
+        // Gather the members of every absorbed group under its new root
+        std::sort(mergedRoots.begin(), mergedRoots.end());
+        mergedRoots.erase(std::unique(mergedRoots.begin(), mergedRoots.end()), mergedRoots.end());
+        mergedMembers.clear();
+        for (int oldRoot : mergedRoots) {
+            int newRoot = findGroup(oldRoot);
+            int slot = groupSlot[oldRoot];
+            if (slot < 0) {
+                mergedMembers.emplace_back(newRoot, oldRoot);  // Singleton
+                continue;
+            }
+            for (int a : groups[slot].members) mergedMembers.emplace_back(newRoot, a);
+            if (oldRoot != newRoot) {
+                groups[slot].members.clear();
+                groups[slot].history.clear();
+                groupSlot[oldRoot] = -1;
+            }
+        }
+        std::sort(mergedMembers.begin(), mergedMembers.end());
+
+        pendingGroups.clear();
+        for (size_t k = 0; k < mergedMembers.size();) {
+            int root = mergedMembers[k].first;
+            if (groupSlot[root] < 0) {
+                if (groups.size() <= groupCount) groups.resize(groupCount + 1);
+                groupSlot[root] = static_cast<int>(groupCount++);
+            }
+            CollisionGroup& group = groups[groupSlot[root]];
+            group.members.clear();
+            for (; k < mergedMembers.size() && mergedMembers[k].first == root; k++) {
+                group.members.push_back(mergedMembers[k].second);
+            }
+            group.history.clear();
+            pendingGroups.push_back(groupSlot[root]);
+        }
+        return true;
+    }
+
+public:
+    BasicRPSSimulator(float width, float height)
+        : boxWidth(width), boxHeight(height),
+          rng(std::chrono::steady_clock::now().time_since_epoch().count()), generation(0) {
+
+        // Initialize objects
+        initializeObjects();
+    }
+
+    // Reproducible simulation: the same params and seed give the same run
+    BasicRPSSimulator(const SimulationParams& params, uint64_t seed)
+        : boxWidth(params.boxWidth), boxHeight(params.boxHeight), rng(seed), generation(0),
+          timestep(params.timestep), sweptCollisions(params.sweptCollisions),
+          inertSleeping(params.inertSleeping) {
+        int counts[typeCount] = {params.rocks, params.papers, params.scissors};
+        for (int t = 3; t < typeCount && t - 3 < static_cast<int>(params.extraTypes.size()); t++) {
+            counts[t] = params.extraTypes[t - 3];
+        }
+        spawn = params.spawn;
+        setThreadCount(params.threads);
+        initializePopulation(counts, spawn);
+    }
+
+    // Number of threads update() may use; 0 picks one per hardware thread.
+    // With more than one thread, large worlds step in parallel with results
+    // bit-identical to the single-threaded path.
+    void setThreadCount(unsigned threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threadCount = threads;
+        pool.reset(threads > 1 ? new WorkerPool(threads) : nullptr);
+        scratch.resize(threads);
+    }
+
+    unsigned getThreadCount() const { return threadCount; }
+
+    // Replace the agents with a new population. Every agent's type follows
+    // from its index and its position and velocity from its own random
+    // stream (see Spawner), so the arrays are filled on the pool when it is
+    // enabled and hold the same agents for the same seed at any thread count.
+    void initializeObjects(int rocks = 5, int papers = 5, int scissors = 5) {
+        int counts[typeCount] = {rocks, papers, scissors};
+        initializePopulation(counts, spawn);
+    }
+
+    // Same, with counts giving the population of each of the typeCount
+    // types, placed as spawn describes
+    void initializePopulation(const int* counts, const SpawnSpec& spawn = SpawnSpec()) {
+        // Interleave the types so no type is clustered at the end of the
+        // store: round r holds one agent of each type with more than r.
+        // Rounds with the same types form a span, at most one per type, so
+        // any agent's type is a lookup into its span.
+        struct TypeSpan {
+            size_t begin, end;
+            int activeCount;
+            uint8_t active[typeCount];
+        };
+        TypeSpan spans[typeCount];
+        int spanCount = 0;
+        size_t total = 0;
+        for (int previous = 0;;) {
+            int next = std::numeric_limits<int>::max();
+            for (int t = 0; t < typeCount; t++) {
+                if (counts[t] > previous) next = std::min(next, counts[t]);
+            }
+            if (next == std::numeric_limits<int>::max()) break;
+            TypeSpan& span = spans[spanCount++];
+            span.activeCount = 0;
+            for (int t = 0; t < typeCount; t++) {
+                if (counts[t] > previous) span.active[span.activeCount++] = static_cast<uint8_t>(t);
+            }
+            span.begin = total;
+            total += static_cast<size_t>(next - previous) * span.activeCount;
+            span.end = total;
+            previous = next;
+        }
+
+        agents.clear();
+        agents.resize(total);
+        agentIds.clear();
+        reorderInterval = reorderCountdown = 1;
+
+        const Spawner spawner(rng, spawn, 4 * initCount++, typeCount, boxWidth, boxHeight);
+        forEachChunk([&](size_t begin, size_t end) {
+            if (begin == end) return;
+            int s = 0;
+            while (spans[s].end <= begin) s++;
+            int turn = static_cast<int>((begin - spans[s].begin) % spans[s].activeCount);
+            for (size_t i = begin; i < end; i++) {
+                if (i == spans[s].end) {
+                    s++;
+                    turn = 0;
+                }
+                int t = spans[s].active[turn];
+                if (++turn == spans[s].activeCount) turn = 0;
+                agents.type[i] = static_cast<uint8_t>(t);
+                spawner.spawn(i, t, agents.x[i], agents.y[i], agents.vx[i], agents.vy[i]);
+            }
+        });
+        for (int t = 0; t < typeCount; t++) typeCounts[t] = std::max(0, counts[t]);
+    }
+
+    uint64_t getSeed() const { return rng.getSeed(); }
+
+    void update() {
+#ifdef RPS_COUNT_ALLOCATIONS
+        uint64_t allocationsBefore = allocationsSoFar();
+        size_t footprintBefore = scratchFootprint();
+#endif
+        arena.reset();
+        pairCounters.clear();
+#ifdef RPS_PROFILE
+        stats = GenerationStats();
+#endif
+
+        reorderAgents();
+
+        if (sweptCollisions) {
+            // Contacts come from the motion itself, so find them before moving
+            {
+                PhaseTimer timer(stats, GenerationStats::DETECTION);
+                findSweptContacts();
+            }
+            timedMove();
+            PhaseTimer timer(stats, GenerationStats::RESOLUTION);
+            resolveSweptContacts();
+        } else {
+            // Update all objects
+            timedMove();
+
+            // Check for collisions
+            resolveCollisions();
+        }
+
+        generation++;
+        conversionTotal += pairCounters.conversions;
+        if (statsFeed && statsFeed->due(generation)) statsFeed->push(samplePopulation());
+#ifdef RPS_PROFILE
+        stats.generation = generation;
+        stats.pairsTested = pairCounters.tested;
+        stats.pairsColliding = pairCounters.colliding;
+        stats.conversions = pairCounters.conversions;
+#endif
+
+#ifdef RPS_COUNT_ALLOCATIONS
+        // Scratch buffers may grow to a new high-water mark; otherwise a
+        // generation must run entirely in memory it already holds
+        uint64_t allocated = allocationsSoFar() - allocationsBefore;
+        if (allocated != 0 && scratchFootprint() == footprintBefore) {
+            std::cerr << "update() made " << allocated << " heap allocations in generation "
+                      << generation << " without growing its scratch buffers" << std::endl;
+            std::abort();
+        }
+#endif
+    }
+
+    // Phase timings and pair counts of the last update(); all zero unless
+    // GenerationStats::enabled
+    const GenerationStats& getGenerationStats() const { return stats; }
+
+    // How far along its velocity each agent moves per generation. Larger
+    // steps trade accuracy for throughput; with swept collisions they
+    // still catch agents that would pass through each other.
+    void setTimestep(float dt) { timestep = dt; }
+    float getTimestep() const { return timestep; }
+
+    void setSweptCollisions(bool enabled) { sweptCollisions = enabled; }
+    bool hasSweptCollisions() const { return sweptCollisions; }
+
+    // Put to sleep, each generation, every agent whose grid cell and
+    // neighbouring cells hold no other type. Sleeping agents take no part
+    // in that generation's collisions, so same-type neighbours are not
+    // nudged apart, and a type spreading into a sleeping region during a
+    // generation reaches it from the next one. Runs stay deterministic and
+    // thread-count independent but differ from runs without sleeping. The
+    // swept path tests every pair regardless.
+    void setInertSleeping(bool enabled) { inertSleeping = enabled; }
+    bool hasInertSleeping() const { return inertSleeping; }
+
+    // Agents asleep in the last generation
+    size_t getSleepingAgentCount() const { return asleepCount; }
+
+    // Periodically sort the agents along a Morton curve for cache locality;
+    // see reorderAgents. Pairs are then scanned in a different order, so a
+    // run with reordering is as deterministic as one without but does not
+    // match it. Agent ids survive the moves: conversion logs, trajectories
+    // and checkpoints use them, and getAgentId maps a slot in getAgents()
+    // back to one.
+    void setSpatialReordering(bool enabled) { spatialReorder = enabled; }
+    bool hasSpatialReordering() const { return spatialReorder; }
+
+    // Id of the agent in a slot of getAgents(): its slot when it was created
+    uint32_t getAgentId(size_t slot) const { return agentId(slot); }
+
+    // True while every agent still sits in the slot matching its id
+    bool agentsInIdOrder() const { return agentIds.empty(); }
+
+    int getGeneration() const { return generation; }
+
+    // Count objects of each type
+    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
+        rocks = typeCounts[static_cast<int>(ObjectType::ROCK)];
+        papers = typeCounts[static_cast<int>(ObjectType::PAPER)];
+        scissors = typeCounts[static_cast<int>(ObjectType::SCISSORS)];
+    }
+
+    // Population of one type, for rule sets past the classic three
+    int getTypeCount(int type) const { return typeCounts[type]; }
+
+    // Check if game is over (only one type remains)
+    bool isGameOver() const {
+        int nonZeroCount = 0;
+        for (int t = 0; t < typeCount; t++) nonZeroCount += typeCounts[t] > 0;
+        return nonZeroCount <= 1;
+    }
+
+    // Get the winning type. Once the game is decided this is the type that
+    // will take over, even if others are not extinct yet.
+    ObjectType getWinner() const {
+        ObjectType winner;
+        if (GameRules::decidedWinner(typeCounts, winner)) return winner;
+
+        return ObjectType::ROCK; // Fallback
+    }
+
+    // True once one remaining type beats all the others, which fixes the
+    // winner; with three types, once at most two remain
+    bool isDecided() const {
+        ObjectType winner;
+        return GameRules::decidedWinner(typeCounts, winner);
+    }
+
+    // Rough number of generations until a decided game is over, or -1 if it
+    // is not decided yet. Mean-field estimate: a loser meets a winner at
+    // rate k * winners with k = 4 * radius * relative speed / area, so
+    // losers / winners falls as exp(-k * agents * t), and the game ends when
+    // a single loser is left. The last losers tend to be far from winners,
+    // so real endgames usually run longer, by up to a factor of 2-3.
+    double estimateRemainingGenerations() const {
+        if (!isDecided()) return -1.0;
+        if (isGameOver()) return 0.0;
+
+        double speedSquared = 0.0, radiusSum = 0.0;
+        for (size_t i = 0; i < agents.size(); i++) {
+            speedSquared += agents.vx[i] * agents.vx[i] + agents.vy[i] * agents.vy[i];
+            radiusSum += agents.hasPerAgentRadii() ? agents.radii[i] : agents.radius;
+        }
+        return remainingGenerationsEstimate(typeCounts[static_cast<int>(getWinner())],
+                                            static_cast<double>(agents.size()), speedSquared, radiusSum,
+                                            boxWidth, boxHeight);
+    }
+
+    // Display current state
+    void displayState() const {
+        displayState(renderer, std::cout);
+    }
+
+    void displayState(AsciiRenderer& target, std::ostream& out) const {
+        captureSnapshot(displaySnapshot, target.getCols(), target.getRows());
+        target.draw(displaySnapshot, out);
+    }
+
+    // Fill a snapshot of the current generation at the given resolution
+    void captureSnapshot(FrameSnapshot& snapshot, int cols, int rows) const {
+        snapshot.generation = generation;
+        getTypeCounts(snapshot.rocks, snapshot.papers, snapshot.scissors);
+        snapshot.boxWidth = boxWidth;
+        snapshot.boxHeight = boxHeight;
+        snapshot.rasterize(agents, cols, rows);
+    }
+
+    // Renderer used by displayState(); set its resolution and redraw mode here
+    AsciiRenderer& getRenderer() { return renderer; }
+
+    const AgentStore& getAgents() const { return agents; }
+
+    // Copy the full state into a checkpoint. This is a handful of bulk
+    // vector copies; CheckpointWriter writes the copy out off the hot path.
+    void captureCheckpoint(SimulatorCheckpoint& checkpoint) const {
+        CheckpointHeader& h = checkpoint.header;
+        std::memcpy(h.magic, checkpointMagic, sizeof(h.magic));
+        h.version = checkpointVersion;
+        h.boxWidth = boxWidth;
+        h.boxHeight = boxHeight;
+        h.radius = agents.radius;
+        h.perAgentRadii = agents.hasPerAgentRadii();
+        h.seed = rng.getSeed();
+        h.initCount = initCount;
+        h.generation = generation;
+        h.agentCount = agents.size();
+        h.hasAgentIds = !agentIds.empty();
+        h.spatialReorder = spatialReorder;
+        h.reorderInterval = reorderInterval;
+        h.reorderCountdown = reorderCountdown;
+        checkpoint.x = agents.x;
+        checkpoint.y = agents.y;
+        checkpoint.vx = agents.vx;
+        checkpoint.vy = agents.vy;
+        checkpoint.radii = agents.radii;
+        checkpoint.type = agents.type;
+        checkpoint.ids = agentIds;
+    }
+
+    // Replace the whole state with a checkpoint's. The file is mapped and
+    // each array copied out of it in bulk. Stepping on from here gives the
+    // same run as the simulator that wrote it. Throws std::runtime_error if
+    // the file is not a complete checkpoint.
+    void loadCheckpoint(const std::string& path) {
+        MappedFile file(path);
+        CheckpointHeader h;
+        bool valid = file.size() >= sizeof(h);
+        if (valid) {
+            std::memcpy(&h, file.data(), sizeof(h));
+            valid = std::memcmp(h.magic, checkpointMagic, sizeof(h.magic)) == 0 &&
+                    h.version == checkpointVersion && h.agentCount < (uint64_t(1) << 40) &&
+                    h.reorderInterval > 0 && SimulatorCheckpoint::layout(h).back() <= file.size();
+        }
+        if (!valid) throw std::runtime_error("not a complete checkpoint: " + path);
+
+        std::vector<size_t> offsets = SimulatorCheckpoint::layout(h);
+        const size_t n = static_cast<size_t>(h.agentCount);
+        const uint8_t* types = file.data() + offsets[5];
+        if (std::any_of(types, types + n, [](uint8_t t) { return t >= typeCount; })) {
+            throw std::runtime_error("checkpoint has types outside this rule set: " + path);
+        }
+        auto floatsAt = [&](int a) { return reinterpret_cast<const float*>(file.data() + offsets[a]); };
+
+        boxWidth = h.boxWidth;
+        boxHeight = h.boxHeight;
+        rng = CounterRng(h.seed);
+        initCount = h.initCount;
+        generation = static_cast<int>(h.generation);
+        agents = AgentStore();
+        agents.radius = h.radius;
+        if (h.perAgentRadii) agents.enablePerAgentRadii();
+        agents.x.assign(floatsAt(0), floatsAt(0) + n);
+        agents.y.assign(floatsAt(1), floatsAt(1) + n);
+        agents.vx.assign(floatsAt(2), floatsAt(2) + n);
+        agents.vy.assign(floatsAt(3), floatsAt(3) + n);
+        if (h.perAgentRadii) agents.radii.assign(floatsAt(4), floatsAt(4) + n);
+        agents.type.assign(types, types + n);
+        agentIds.clear();
+        if (h.hasAgentIds) {
+            const uint32_t* ids = reinterpret_cast<const uint32_t*>(file.data() + offsets[6]);
+            agentIds.assign(ids, ids + n);
+        }
+        spatialReorder = h.spatialReorder != 0;
+        reorderInterval = h.reorderInterval;
+        reorderCountdown = h.reorderCountdown;
+        countTypes();
+        parallelBackoff = 0;
+        serialGenerationsLeft = 0;
+        serialSeconds = 0.0;
+    }
+
+    // Log every conversion from now on, or stop with nullptr. The log is
+    // not owned and must outlive its use here.
+    void setConversionLog(ConversionLog* log) { conversionLog = log; }
+
+    // Sample into feed every feed->getInterval() generations from now on,
+    // or stop with nullptr. The feed is not owned and must outlive its use
+    // here; its first sample counts conversions from this call.
+    void setStatsFeed(StatsFeed* feed) {
+        statsFeed = feed;
+        if (feed) feed->setBaseline(generation, conversionTotal);
+    }
+
+    // The population as it stands, without waiting for a feed. Conversions
+    // since a previous sample are left for StatsFeed to fill in.
+    PopulationSample samplePopulation() const {
+        static_assert(typeCount <= PopulationSample::maxTypes, "samples hold one count per ObjectType");
+        constexpr int cells = PopulationSample::clusterGrid;
+        PopulationSample sample;
+        sample.generation = generation;
+        sample.typeCount = typeCount;
+        std::copy(typeCounts, typeCounts + typeCount, sample.counts);
+        sample.conversionTotal = conversionTotal;
+
+        const size_t n = agents.size();
+        if (n == 0) return sample;
+        sampleCells.assign(static_cast<size_t>(cells) * cells * typeCount, 0);
+        const float scaleX = cells / boxWidth, scaleY = cells / boxHeight;
+        double speed = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            speed += std::sqrt(agents.vx[i] * agents.vx[i] + agents.vy[i] * agents.vy[i]);
+            int cx = std::clamp(static_cast<int>(agents.x[i] * scaleX), 0, cells - 1);
+            int cy = std::clamp(static_cast<int>(agents.y[i] * scaleY), 0, cells - 1);
+            sampleCells[(cy * cells + cx) * typeCount + agents.type[i]]++;
+        }
+        sample.meanSpeed = speed / static_cast<double>(n);
+
+        // Chance that another agent in the same cell shares an agent's type,
+        // against the chance for types scattered at random
+        double sameType = 0.0;
+        uint64_t neighboured = 0;
+        for (size_t c = 0; c < sampleCells.size(); c += typeCount) {
+            int occupants = 0;
+            for (int t = 0; t < typeCount; t++) occupants += sampleCells[c + t];
+            if (occupants < 2) continue;
+            for (int t = 0; t < typeCount; t++) {
+                sameType += static_cast<double>(sampleCells[c + t]) * (sampleCells[c + t] - 1) / (occupants - 1);
+            }
+            neighboured += occupants;
+        }
+        double mixed = 0.0;
+        for (int t = 0; t < typeCount; t++) {
+            double share = static_cast<double>(typeCounts[t]) / static_cast<double>(n);
+            mixed += share * share;
+        }
+        if (neighboured > 0 && mixed < 1.0) {
+            sample.clustering = (sameType / static_cast<double>(neighboured) - mixed) / (1.0 - mixed);
+        }
+        return sample;
+    }
+
+    float getBoxWidth() const { return boxWidth; }
+    float getBoxHeight() const { return boxHeight; }
+};
+
+using RPSSimulator = BasicRPSSimulator<ClassicRules>;
+using LizardSpockSimulator = BasicRPSSimulator<LizardSpockRules>;
+
+// Lock-free single-producer/single-consumer slot. The producer fills the
+// back buffer and swaps it into the middle; the consumer swaps the middle
+// out when it holds something new. Neither side ever waits on the other,
+// and the consumer always gets the newest published value.
+template <typename T>
+class TripleBuffer {
+private:
+    static constexpr unsigned fresh = 4;    // Set on the middle index when it was published but not taken
+
+    T buffers[3];
+    std::atomic<unsigned> middle{1};
+    unsigned back = 0;      // Owned by the producer
+    unsigned front = 2;     // Owned by the consumer
+
+public:
+    T& writeBuffer() { return buffers[back]; }
+
+    void publish() {
+        back = middle.exchange(back | fresh, std::memory_order_acq_rel) & ~fresh;
+    }
+
+    // True if the consumer has taken everything published so far
+    bool taken() const { return !(middle.load(std::memory_order_relaxed) & fresh); }
+
+    // Take the newest published value if there is one; readBuffer() then holds it
+    bool acquire() {
+        if (taken()) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~fresh;
+        return true;
+    }
+
+    const T& readBuffer() const { return buffers[front]; }
+};
+
+// Draws snapshots on its own thread at a fixed frame rate, so the
+// simulation never waits on terminal I/O. publish() only captures a new
+// snapshot once the last one has been taken, so a fast simulation does not
+// pay for frames that would never be shown.
+class AsyncDisplay {
+private:
+    AsciiRenderer renderer;
+    std::ostream& out;
+    std::chrono::steady_clock::duration frameInterval;
+    TripleBuffer<FrameSnapshot> slot;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+    void renderLoop() {
+        auto next = std::chrono::steady_clock::now();
+        for (;;) {
+            bool last = stopping.load(std::memory_order_acquire);
+            if (slot.acquire()) renderer.draw(slot.readBuffer(), out);
+            if (last) return;
+            next = std::max(next + frameInterval, std::chrono::steady_clock::now());
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+public:
+    AsyncDisplay(const AsciiRenderer& renderer, double framesPerSecond, std::ostream& out = std::cout)
+        : renderer(renderer), out(out),
+          frameInterval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              std::chrono::duration<double>(1.0 / std::max(framesPerSecond, 0.1)))) {
+        thread = std::thread(&AsyncDisplay::renderLoop, this);
+    }
+
+    ~AsyncDisplay() { stop(); }
+
+    AsyncDisplay(const AsyncDisplay&) = delete;
+    AsyncDisplay& operator=(const AsyncDisplay&) = delete;
+
+    // Hand the current generation to the render thread. With force, the
+    // snapshot is captured even if the previous one is still waiting.
+    void publish(const RPSSimulator& simulator, bool force = false) {
+        if (!force && !slot.taken()) return;
+        simulator.captureSnapshot(slot.writeBuffer(), renderer.getCols(), renderer.getRows());
+        slot.publish();
+    }
+
+    // Draw whatever was published last and join the render thread
+    void stop() {
+        if (!thread.joinable()) return;
+        stopping.store(true, std::memory_order_release);
+        thread.join();
+    }
+};
+
+// Saves checkpoints without stalling the simulation. save() copies the
+// state, which is a few bulk array copies, and a background thread writes
+// the copy. A save issued while the previous one is still writing waits
+// for it, so at most one copy is held.
+class CheckpointWriter {
+private:
+    SimulatorCheckpoint pending;
+    std::string pendingPath;
+    bool hasPending = false;
+    bool stopping = false;
+    std::string error;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread thread;
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] { return stopping || hasPending; });
+            if (!hasPending) return;
+            lock.unlock();
+            std::string failure;
+            try {
+                pending.write(pendingPath);
+            } catch (const std::exception& e) {
+                failure = e.what();
+            }
+            lock.lock();
+            if (!failure.empty()) error = failure;
+            hasPending = false;
+            changed.notify_all();
+        }
+    }
+
+    // Called with the lock held
+    void throwIfFailed() {
+        if (error.empty()) return;
+        std::string failure;
+        failure.swap(error);
+        throw std::runtime_error(failure);
+    }
+
+public:
+    CheckpointWriter() : thread(&CheckpointWriter::writerLoop, this) {}
+
+    ~CheckpointWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Capture the simulator now and write it to path in the background.
+    // Throws std::runtime_error if an earlier save failed.
+    template <typename RuleSet>
+    void save(const BasicRPSSimulator<RuleSet>& simulator, const std::string& path) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return !hasPending; });
+        throwIfFailed();
+        simulator.captureCheckpoint(pending);
+        pendingPath = path;
+        hasPending = true;
+        changed.notify_all();
+    }
+
+    // Block until the last save is on disk. Throws std::runtime_error if it failed.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return !hasPending; });
+        throwIfFailed();
+    }
+};
+
+// Binary trajectory files. All fields are little-endian, as written by the
+// host. The layout is:
+//
+//   TrajectoryHeader
+//   frame 0, frame 1, ...
+//   frame index: frameCount uint64 file offsets
+//
+// Each frame is a TrajectoryFrameHeader followed by
+//   positions:   agentCount (x, y) uint16 pairs, quantized over the box
+//   types:       agentCount 2-bit ObjectTypes, four per byte, low bits first
+//   conversions: the agents whose type changed since the previous frame,
+//                as LEB128 varints of the gap to the previous such agent
+//
+// Frames vary in size because of the conversions, so the index at the end
+// is what lets a reader seek straight to any generation.
+struct TrajectoryHeader {
+    char magic[4];
+    uint32_t version;
+    float boxWidth, boxHeight;
+    uint64_t seed;
+    uint64_t agentCount;
+    uint64_t frameCount;
+    uint64_t indexOffset;
+};
+static_assert(sizeof(TrajectoryHeader) == 48, "trajectory header must not be padded");
+
+struct TrajectoryFrameHeader {
+    uint32_t generation;
+    uint32_t counts[3];         // Rocks, papers, scissors
+    uint32_t conversionCount;
+    uint32_t conversionBytes;
+};
+static_assert(sizeof(TrajectoryFrameHeader) == 24, "trajectory frame header must not be padded");
+
+constexpr char trajectoryMagic[4] = {'R', 'P', 'S', 'T'};
+constexpr uint32_t trajectoryVersion = 1;
+constexpr float trajectoryQuantSteps = 65535.0f;
+
+// Streams frames to a trajectory file. record() only copies the agents'
+// state; quantizing, encoding and writing happen on a background thread.
+// The queue is bounded, so a writer that falls far behind slows the
+// simulation rather than buffering without limit.
+class TrajectoryWriter {
+private:
+    struct RawFrame {
+        TrajectoryFrameHeader header;
+        std::vector<float> x, y;
+        std::vector<uint8_t> type;
+    };
+
+    static constexpr size_t maxQueued = 8;
+
+    std::FILE* file;
+    TrajectoryHeader header;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<RawFrame> queue;
+    std::vector<RawFrame> spare;        // Recycled frames, so record() does not allocate
+    bool stopping = false;
+    bool failed = false;
+
+    // Writer thread state
+    std::vector<uint64_t> frameOffsets;
+    std::vector<uint8_t> previousTypes;
+    std::vector<uint8_t> encoded;
+    uint64_t offset = sizeof(TrajectoryHeader);
+
+    void write(const void* data, size_t size) {
+        if (size && std::fwrite(data, 1, size, file) != size) failed = true;
+        offset += size;
+    }
+
+    void encode(RawFrame& frame) {
+        const size_t n = frame.type.size();
+        const float scaleX = trajectoryQuantSteps / header.boxWidth;
+        const float scaleY = trajectoryQuantSteps / header.boxHeight;
+
+        encoded.clear();
+        encoded.resize(4 * n + (n + 3) / 4);
+        uint8_t* positions = encoded.data();
+        for (size_t i = 0; i < n; i++) {
+            auto quantize = [](float v, float scale) {
+                return static_cast<uint16_t>(std::min(trajectoryQuantSteps, std::max(0.0f, v * scale)) + 0.5f);
+            };
+            uint16_t q[2] = {quantize(frame.x[i], scaleX), quantize(frame.y[i], scaleY)};
+            std::memcpy(positions + 4 * i, q, sizeof(q));
+        }
+        uint8_t* types = positions + 4 * n;
+        for (size_t i = 0; i < n; i++) types[i / 4] |= static_cast<uint8_t>(frame.type[i] << (2 * (i % 4)));
+
+        // Conversions against the previous frame; none for the first
+        if (previousTypes.size() != n) previousTypes = frame.type;
+        size_t before = encoded.size();
+        uint32_t conversions = 0;
+        uint64_t last = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (frame.type[i] == previousTypes[i]) continue;
+            uint64_t gap = i - last;
+            last = i;
+            conversions++;
+            do {
+                encoded.push_back(static_cast<uint8_t>((gap & 0x7f) | (gap > 0x7f ? 0x80 : 0)));
+                gap >>= 7;
+            } while (gap);
+        }
+        previousTypes.swap(frame.type);
+        frame.header.conversionCount = conversions;
+        frame.header.conversionBytes = static_cast<uint32_t>(encoded.size() - before);
+    }
+
+    void writerLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            changed.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            RawFrame frame = std::move(queue.front());
+            queue.pop_front();
+            changed.notify_all();
+            lock.unlock();
+
+            encode(frame);
+            frameOffsets.push_back(offset);
+            write(&frame.header, sizeof(frame.header));
+            write(encoded.data(), encoded.size());
+
+            lock.lock();
+            spare.push_back(std::move(frame));
+        }
+    }
+
+public:
+    // Throws std::runtime_error if the file cannot be created
+    TrajectoryWriter(const std::string& path, const RPSSimulator& simulator) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) throw std::runtime_error("cannot create trajectory file " + path);
+        std::memcpy(header.magic, trajectoryMagic, sizeof(header.magic));
+        header.version = trajectoryVersion;
+        header.boxWidth = simulator.getBoxWidth();
+        header.boxHeight = simulator.getBoxHeight();
+        header.seed = simulator.getSeed();
+        header.agentCount = simulator.getAgents().size();
+        header.frameCount = 0;
+        header.indexOffset = 0;
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) failed = true;
+        thread = std::thread(&TrajectoryWriter::writerLoop, this);
+    }
+
+    ~TrajectoryWriter() {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // Nothing useful to do with a write error during unwinding
+        }
+    }
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    // Queue the simulator's current generation
+    void record(const RPSSimulator& simulator) {
+        const AgentStore& agents = simulator.getAgents();
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return queue.size() < maxQueued; });
+        RawFrame frame;
+        if (!spare.empty()) {
+            frame = std::move(spare.back());
+            spare.pop_back();
+        }
+        lock.unlock();
+
+        int rocks, papers, scissors;
+        simulator.getTypeCounts(rocks, papers, scissors);
+        frame.header.generation = static_cast<uint32_t>(simulator.getGeneration());
+        frame.header.counts[0] = static_cast<uint32_t>(rocks);
+        frame.header.counts[1] = static_cast<uint32_t>(papers);
+        frame.header.counts[2] = static_cast<uint32_t>(scissors);
+        if (simulator.agentsInIdOrder()) {
+            frame.x = agents.x;
+            frame.y = agents.y;
+            frame.type = agents.type;
+        } else {
+            // Frames list agents by id, so a reordered run reads like any other
+            const size_t n = agents.size();
+            frame.x.resize(n);
+            frame.y.resize(n);
+            frame.type.resize(n);
+            for (size_t slot = 0; slot < n; slot++) {
+                uint32_t id = simulator.getAgentId(slot);
+                frame.x[id] = agents.x[slot];
+                frame.y[id] = agents.y[slot];
+                frame.type[id] = agents.type[slot];
+            }
+        }
+
+        lock.lock();
+        queue.push_back(std::move(frame));
+        changed.notify_all();
+    }
+
+    // Write out every queued frame and the index. Throws std::runtime_error
+    // if any write failed.
+    void close() {
+        if (!file) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+
+        header.frameCount = frameOffsets.size();
+        header.indexOffset = offset;
+        write(frameOffsets.data(), frameOffsets.size() * sizeof(uint64_t));
+        if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            failed = true;
+        }
+        if (std::fclose(file) != 0) failed = true;
+        file = nullptr;
+        if (failed) throw std::runtime_error("error writing trajectory file");
+    }
+};
+
+// One generation of a mapped trajectory. Valid while its reader is alive.
+class TrajectoryFrame {
+private:
+    TrajectoryFrameHeader header;
+    const uint8_t* positions;
+    const uint8_t* types;
+    const uint8_t* conversionData;
+    float scaleX, scaleY;
+
+public:
+    TrajectoryFrame(const uint8_t* data, uint64_t agentCount, float boxWidth, float boxHeight)
+        : scaleX(boxWidth / trajectoryQuantSteps), scaleY(boxHeight / trajectoryQuantSteps) {
+        std::memcpy(&header, data, sizeof(header));
+        positions = data + sizeof(header);
+        types = positions + 4 * agentCount;
+        conversionData = types + (agentCount + 3) / 4;
+    }
+
+    int getGeneration() const { return static_cast<int>(header.generation); }
+
+    void getTypeCounts(int& rocks, int& papers, int& scissors) const {
+        rocks = static_cast<int>(header.counts[0]);
+        papers = static_cast<int>(header.counts[1]);
+        scissors = static_cast<int>(header.counts[2]);
+    }
+
+    float x(size_t agent) const { return position(agent, 0) * scaleX; }
+    float y(size_t agent) const { return position(agent, 1) * scaleY; }
+
+    ObjectType type(size_t agent) const {
+        return static_cast<ObjectType>((types[agent / 4] >> (2 * (agent % 4))) & 3);
+    }
+
+    size_t getConversionCount() const { return header.conversionCount; }
+
+    // Agents whose type changed since the previous frame, in ascending order
+    std::vector<uint64_t> conversions() const {
+        std::vector<uint64_t> agents;
+        agents.reserve(header.conversionCount);
+        const uint8_t* p = conversionData;
+        uint64_t agent = 0;
+        for (uint32_t c = 0; c < header.conversionCount; c++) {
+            uint64_t gap = 0;
+            for (int shift = 0;; shift += 7) {
+                gap |= static_cast<uint64_t>(*p & 0x7f) << shift;
+                if (!(*p++ & 0x80)) break;
+            }
+            agent += gap;
+            agents.push_back(agent);
+        }
+        return agents;
+    }
+
+private:
+    uint16_t position(size_t agent, int axis) const {
+        uint16_t q;
+        std::memcpy(&q, positions + 4 * agent + 2 * axis, sizeof(q));
+        return q;
+    }
+};
+
+// Maps a trajectory file and hands out any frame in O(1) through the frame
+// index, touching only the pages that frame lives on
+class TrajectoryReader {
+private:
+    MappedFile file;
+    TrajectoryHeader header;
+    const uint8_t* data;
+    const uint8_t* index;
+
+public:
+    // Throws std::runtime_error if the file is missing, truncated or not a
+    // finished trajectory
+    explicit TrajectoryReader(const std::string& path) : file(path), data(file.data()) {
+        size_t size = file.size();
+        bool valid = size >= sizeof(header);
+        if (valid) {
+            std::memcpy(&header, data, sizeof(header));
+            valid = std::memcmp(header.magic, trajectoryMagic, sizeof(header.magic)) == 0 &&
+                    header.version == trajectoryVersion && header.indexOffset >= sizeof(header) &&
+                    header.frameCount <= (size - std::min<uint64_t>(size, header.indexOffset)) / sizeof(uint64_t);
+        }
+        if (!valid) throw std::runtime_error("not a finished trajectory file: " + path);
+        index = data + header.indexOffset;
+    }
+
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+    float getBoxWidth() const { return header.boxWidth; }
+    float getBoxHeight() const { return header.boxHeight; }
+    uint64_t getSeed() const { return header.seed; }
+    uint64_t getAgentCount() const { return header.agentCount; }
+    size_t getFrameCount() const { return static_cast<size_t>(header.frameCount); }
+
+    // Frame number i, in recording order. Throws std::out_of_range past the end.
+    TrajectoryFrame frame(size_t i) const {
+        if (i >= header.frameCount) throw std::out_of_range("trajectory frame out of range");
+        uint64_t frameOffset;
+        std::memcpy(&frameOffset, index + i * sizeof(uint64_t), sizeof(frameOffset));
+        uint64_t fixedBytes = sizeof(TrajectoryFrameHeader) + 4 * header.agentCount + (header.agentCount + 3) / 4;
+        if (frameOffset < sizeof(header) || frameOffset + fixedBytes > header.indexOffset) {
+            throw std::runtime_error("corrupt trajectory frame index");
+        }
+        return TrajectoryFrame(data + frameOffset, header.agentCount, header.boxWidth, header.boxHeight);
+    }
+};
+
+// Writes GenerationStats as a Chrome trace for chrome://tracing or
+// Perfetto: one complete event per phase, plus a counter track for the
+// pair counts. Throws std::runtime_error if the file cannot be written.
+class ChromeTraceWriter {
+private:
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{nullptr, std::fclose};
+    std::string path;
+    double origin = -1.0;     // First recorded phase start; trace timestamps count from here
+    bool firstEvent = true;
+
+    void event(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        std::fputs(firstEvent ? "\n" : ",\n", file.get());
+        firstEvent = false;
+        va_list args;
+        va_start(args, format);
+        std::vfprintf(file.get(), format, args);
+        va_end(args);
+    }
+
+public:
+    explicit ChromeTraceWriter(const std::string& tracePath) : path(tracePath) {
+        file.reset(std::fopen(path.c_str(), "w"));
+        if (!file) throw std::runtime_error("cannot create trace " + path);
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file.get());
+    }
+
+    ~ChromeTraceWriter() {
+        try {
+            close();
+        } catch (const std::exception&) {
+        }
+    }
+
+    void record(const GenerationStats& stats) {
+        if (origin < 0) {
+            origin = stats.phaseStart[GenerationStats::MOVE];
+            for (int p = 0; p < GenerationStats::PHASE_COUNT; p++) {
+                if (stats.phaseSeconds[p] != 0.0) origin = std::min(origin, stats.phaseStart[p]);
+            }
+        }
+        double end = origin;
+        for (int p = 0; p < GenerationStats::PHASE_COUNT; p++) {
+            if (stats.phaseSeconds[p] == 0.0) continue;
+            double ts = (stats.phaseStart[p] - origin) * 1e6;
+            end = std::max(end, stats.phaseStart[p] + stats.phaseSeconds[p]);
+            event("{\"name\":\"%s\",\"cat\":\"update\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                  "\"pid\":1,\"tid\":1,\"args\":{\"generation\":%d}}",
+                  GenerationStats::phaseName(p), ts, stats.phaseSeconds[p] * 1e6, stats.generation);
+        }
+        event("{\"name\":\"pairs\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"tested\":%llu,"
+              "\"colliding\":%llu,\"conversions\":%llu}}",
+              (end - origin) * 1e6, static_cast<unsigned long long>(stats.pairsTested),
+              static_cast<unsigned long long>(stats.pairsColliding),
+              static_cast<unsigned long long>(stats.conversions));
+    }
+
+    // Finish the JSON and close the file; further records are an error
+    void close() {
+        if (!file) return;
+        std::fputs("\n]}\n", file.get());
+        bool ok = std::ferror(file.get()) == 0;
+        ok = std::fclose(file.release()) == 0 && ok;
+        if (!ok) throw std::runtime_error("error writing trace " + path);
+    }
+};
+
+// Thread pool with one task deque per worker. A worker runs its own newest
+// task first and, when it runs dry, steals the oldest task from a peer, so
+// uneven task lengths still keep every core busy.
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void(unsigned)>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued = 0;          // Tasks waiting in some deque
+    size_t unfinished = 0;      // Tasks queued or running
+    unsigned nextQueue = 0;
+    bool stopping = false;
+
+    bool popOwn(unsigned worker, std::function<void(unsigned)>& task) {
+        Queue& q = *queues[worker];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty()) return false;
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned worker, std::function<void(unsigned)>& task) {
+        for (unsigned k = 1; k < queues.size(); k++) {
+            Queue& q = *queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty()) continue;
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned worker) {
+        std::function<void(unsigned)> task;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(stateMutex);
+                workAvailable.wait(lock, [&] { return stopping || queued > 0; });
+                if (stopping && queued == 0) return;
+            }
+            if (!popOwn(worker, task) && !steal(worker, task)) continue;
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                queued--;
+            }
+
+            task(worker);
+            task = nullptr;
+
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (--unfinished == 0) allDone.notify_all();
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned workers) {
+        workers = std::max(1u, workers);
+        for (unsigned w = 0; w < workers; w++) {
+            queues.emplace_back(new Queue());
+        }
+        for (unsigned w = 0; w < workers; w++) {
+            threads.emplace_back(&WorkStealingPool::workerLoop, this, w);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        workAvailable.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    unsigned size() const { return static_cast<unsigned>(threads.size()); }
+
+    // Queue task(worker) on the next deque in round-robin order
+    void submit(std::function<void(unsigned)> task) {
+        unsigned target;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            target = nextQueue++ % queues.size();
+            unfinished++;
+        }
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued++;
+        }
+        workAvailable.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        allDone.wait(lock, [&] { return unfinished == 0; });
+    }
+};
+
+// Steps worldBatchWidth small worlds with the same params in lockstep, one
+// world per SIMD lane: each agent's fields for all the worlds sit side by
+// side, so the move kernels and the pair filter handle every world at
+// once. Each lane reproduces BasicRPSSimulator for its seed exactly. It
+// starts from that simulator's agents and tests every pair in i < j order,
+// which is the order the grid reproduces, and resolves hits with the same
+// GameRules::resolveCollision. Small worlds gain the most, since a single
+// one of them leaves most of a vector idle.
+//
+// Lanes are loaded with a seed and retired independently, so a runner can
+// refill a lane as soon as its world ends. Retired lanes keep moving with
+// the rest but take no part in collisions. Swept collisions and sleeping
+// are not supported.
+template <typename RuleSet>
+class BasicWorldBatch {
+public:
+    static constexpr int typeCount = RuleSet::typeCount;
+    static constexpr size_t width = worldBatchWidth;
+
+    // Read-only view of one lane, with the simulator calls
+    // EnsembleSummary::record makes
+    class World {
+    public:
+        World(const BasicWorldBatch& batch, size_t lane) : batch(batch), lane(lane) {}
+
+        int getGeneration() const { return batch.generations[lane]; }
+        int getTypeCount(int type) const { return batch.typeCounts[lane][type]; }
+        uint64_t getSeed() const { return batch.seeds[lane]; }
+
+        bool isGameOver() const {
+            int nonZeroCount = 0;
+            for (int t = 0; t < typeCount; t++) nonZeroCount += batch.typeCounts[lane][t] > 0;
+            return nonZeroCount <= 1;
+        }
+
+        bool isDecided() const {
+            ObjectType winner;
+            return GameRules::decidedWinner(batch.typeCounts[lane], winner);
+        }
+
+        ObjectType getWinner() const {
+            ObjectType winner;
+            if (GameRules::decidedWinner(batch.typeCounts[lane], winner)) return winner;
+            return ObjectType::ROCK; // Fallback
+        }
+
+        double estimateRemainingGenerations() const {
+            if (!isDecided()) return -1.0;
+            if (isGameOver()) return 0.0;
+            double speedSquared = 0.0, radiusSum = 0.0;
+            for (size_t a = 0; a < batch.agentCount; a++) {
+                float vx = batch.vx[a * width + lane], vy = batch.vy[a * width + lane];
+                speedSquared += vx * vx + vy * vy;
+                radiusSum += batch.radius;
+            }
+            return remainingGenerationsEstimate(batch.typeCounts[lane][static_cast<int>(getWinner())],
+                                                static_cast<double>(batch.agentCount), speedSquared, radiusSum,
+                                                batch.boxWidth, batch.boxHeight);
+        }
+
+    private:
+        const BasicWorldBatch& batch;
+        size_t lane;
+    };
+
+private:
+    using GameRules = BasicGameRules<RuleSet>;
+
+    SimulationParams params;
+    float boxWidth, boxHeight;
+    float timestep;
+    float radius = AgentStore::defaultRadius;
+    size_t agentCount = 0;
+    std::vector<float> x, y, vx, vy;     // agentCount x width, lanes innermost
+    std::vector<uint8_t> type;
+    int typeCounts[width][typeCount] = {};
+    int generations[width] = {};
+    uint64_t seeds[width] = {};
+    unsigned activeLanes = 0;            // Bit per lane holding a live world
+
+public:
+    // Throws std::runtime_error for params only the full simulator supports
+    explicit BasicWorldBatch(const SimulationParams& params)
+        : params(params), boxWidth(params.boxWidth), boxHeight(params.boxHeight), timestep(params.timestep) {
+        if (params.sweptCollisions || params.inertSleeping) {
+            throw std::runtime_error("world batches have no swept collisions or sleeping");
+        }
+        this->params.threads = 1;
+    }
+
+    // Start lane over with the world BasicRPSSimulator builds for seed
+    void load(size_t lane, uint64_t seed) {
+        BasicRPSSimulator<RuleSet> start(params, seed);
+        const AgentStore& agents = start.getAgents();
+        if (activeLanes == 0 && agentCount != agents.size()) {
+            agentCount = agents.size();
+            x.assign(agentCount * width, 0.0f);
+            y.assign(agentCount * width, 0.0f);
+            vx.assign(agentCount * width, 0.0f);
+            vy.assign(agentCount * width, 0.0f);
+            type.assign(agentCount * width, 0);
+        }
+        radius = agents.radius;
+        for (size_t a = 0; a < agentCount; a++) {
+            x[a * width + lane] = agents.x[a];
+            y[a * width + lane] = agents.y[a];
+            vx[a * width + lane] = agents.vx[a];
+            vy[a * width + lane] = agents.vy[a];
+            type[a * width + lane] = agents.type[a];
+        }
+        for (int t = 0; t < typeCount; t++) typeCounts[lane][t] = start.getTypeCount(t);
+        generations[lane] = 0;
+        seeds[lane] = seed;
+        activeLanes |= 1u << lane;
+    }
+
+    void retire(size_t lane) { activeLanes &= ~(1u << lane); }
+    bool isActive(size_t lane) const { return activeLanes >> lane & 1u; }
+    bool empty() const { return activeLanes == 0; }
+
+    World world(size_t lane) const { return World(*this, lane); }
+
+    // One generation for every live lane
+    void update() {
+        if (activeLanes == 0) return;
+        const size_t n = agentCount * width;
+        if (timestep != 1.0f) {
+            for (size_t i = 0; i < n; i++) {
+                x[i] += vx[i] * timestep;
+                y[i] += vy[i] * timestep;
+            }
+        } else {
+            const MoveKernels& kernels = MoveKernels::active();
+            kernels.integrate(x.data(), vx.data(), n);
+            kernels.integrate(y.data(), vy.data(), n);
+        }
+        const MoveKernels& kernels = MoveKernels::active();
+        kernels.reflect(x.data(), vx.data(), nullptr, radius, n, boxWidth);
+        kernels.reflect(y.data(), vy.data(), nullptr, radius, n, boxHeight);
+
+        const WorldBatchKernels& filter = WorldBatchKernels::active();
+        const float contact = radius + radius;
+        const float limit = contact * contact * contactFilterScale;
+        for (size_t i = 0; i < agentCount; i++) {
+            unsigned lanes;
+            for (size_t j = i + 1; (j = filter.firstTouch(x.data(), y.data(), i, j, agentCount, limit, lanes)) <
+                                   agentCount; j++) {
+                for (lanes &= activeLanes; lanes; lanes &= lanes - 1) {
+                    size_t a = i * width + __builtin_ctz(lanes), b = j * width + __builtin_ctz(lanes);
+                    if (!withinContact(x[a] - x[b], y[a] - y[b], contact)) continue;
+                    float ra = radius, rb = radius;
+                    GameObject obj1(type[a], x[a], y[a], vx[a], vy[a], ra);
+                    GameObject obj2(type[b], x[b], y[b], vx[b], vy[b], rb);
+                    GameRules::resolveCollision(obj1, obj2, typeCounts[__builtin_ctz(lanes)]);
+                }
+            }
+        }
+        for (size_t lane = 0; lane < width; lane++) generations[lane] += isActive(lane);
+    }
+};
+
+using WorldBatch = BasicWorldBatch<ClassicRules>;
+
+// Aggregated outcome of every run for one parameter set
+struct EnsembleSummary {
+    SimulationParams params;
+    uint64_t runs = 0;
+    uint64_t wins[3] = {0, 0, 0};       // Indexed by ObjectType
+    uint64_t unfinished = 0;            // Runs that hit maxGenerations
+    int bucketWidth = 10;
+    bool untilDecided = false;          // Runs stopped once decided rather than at extinction
+    std::vector<uint64_t> extinctionHistogram;  // Generations until the run stopped, bucketed
+    double estimatedExtinctionSum = 0.0;        // Stopped generation plus estimated remainder, over finished runs
+
+    // sim is an RPSSimulator or a WorldBatch::World
+    template <typename World>
+    void record(const World& sim) {
+        runs++;
+        if (untilDecided ? !sim.isDecided() : !sim.isGameOver()) {
+            unfinished++;
+            return;
+        }
+        wins[static_cast<int>(sim.getWinner())]++;
+        size_t bucket = static_cast<size_t>(sim.getGeneration() / bucketWidth);
+        if (extinctionHistogram.size() <= bucket) extinctionHistogram.resize(bucket + 1, 0);
+        extinctionHistogram[bucket]++;
+        estimatedExtinctionSum += sim.getGeneration() + sim.estimateRemainingGenerations();
+    }
+
+    uint64_t finished() const { return runs - unfinished; }
+
+    void merge(const EnsembleSummary& other) {
+        runs += other.runs;
+        for (int t = 0; t < 3; t++) wins[t] += other.wins[t];
+        unfinished += other.unfinished;
+        estimatedExtinctionSum += other.estimatedExtinctionSum;
+        if (extinctionHistogram.size() < other.extinctionHistogram.size()) {
+            extinctionHistogram.resize(other.extinctionHistogram.size(), 0);
+        }
+        for (size_t b = 0; b < other.extinctionHistogram.size(); b++) {
+            extinctionHistogram[b] += other.extinctionHistogram[b];
+        }
+    }
+};
+
+// Runs every parameter set in a grid once per seed in a seed range, spread
+// over a work-stealing pool. Each task steps its seeds through a WorldBatch,
+// refilling a lane whenever its run ends, or one simulator at a time for
+// params a batch can't run; both give the same results. Workers fold
+// results into private summaries that are merged at the end. With
+// untilDecided, each run stops as soon as its winner is fixed instead of
+// stepping on until the losing type is extinct.
+class EnsembleRunner {
+private:
+    WorkStealingPool pool;
+    int bucketWidth;
+    uint64_t runsPerTask;
+    bool untilDecided;
+
+public:
+    explicit EnsembleRunner(unsigned threads = 0, int histogramBucketWidth = 10, uint64_t batchSize = 16,
+                            bool untilDecided = true)
+        : pool(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          bucketWidth(histogramBucketWidth), runsPerTask(std::max<uint64_t>(1, batchSize)),
+          untilDecided(untilDecided) {}
+
+    unsigned getThreadCount() const { return pool.size(); }
+
+    // Run seeds [first, last) through one batch, recording each world as it ends
+    void runBatched(const SimulationParams& params, uint64_t first, uint64_t last, EnsembleSummary& summary) const {
+        WorldBatch batch(params);
+        uint64_t next = first;
+        for (size_t lane = 0; lane < WorldBatch::width && next < last; lane++) batch.load(lane, next++);
+        while (!batch.empty()) {
+            for (size_t lane = 0; lane < WorldBatch::width; lane++) {
+                while (batch.isActive(lane)) {
+                    WorldBatch::World world = batch.world(lane);
+                    if (world.getGeneration() < params.maxGenerations &&
+                        !(untilDecided ? world.isDecided() : world.isGameOver())) {
+                        break;
+                    }
+                    summary.record(world);
+                    if (next < last) {
+                        batch.load(lane, next++);
+                    } else {
+                        batch.retire(lane);
+                    }
+                }
+            }
+            batch.update();
+        }
+    }
+
+    std::vector<EnsembleSummary> run(const std::vector<SimulationParams>& grid,
+                                     uint64_t firstSeed, uint64_t seedCount) {
+        std::vector<std::vector<EnsembleSummary>> partial(pool.size());
+        for (auto& perWorker : partial) {
+            perWorker.resize(grid.size());
+            for (size_t p = 0; p < grid.size(); p++) {
+                perWorker[p].params = grid[p];
+                perWorker[p].bucketWidth = bucketWidth;
+                perWorker[p].untilDecided = untilDecided;
+            }
+        }
+
+        for (size_t p = 0; p < grid.size(); p++) {
+            for (uint64_t begin = 0; begin < seedCount; begin += runsPerTask) {
+                uint64_t end = std::min(seedCount, begin + runsPerTask);
+                pool.submit([&, p, begin, end](unsigned worker) {
+                    const SimulationParams& params = grid[p];
+                    if (!params.sweptCollisions && !params.inertSleeping) {
+                        runBatched(params, firstSeed + begin, firstSeed + end, partial[worker][p]);
+                        return;
+                    }
+                    for (uint64_t s = begin; s < end; s++) {
+                        RPSSimulator sim(params, firstSeed + s);
+                        while (sim.getGeneration() < params.maxGenerations &&
+                               !(untilDecided ? sim.isDecided() : sim.isGameOver())) {
+                            sim.update();
+                        }
+                        partial[worker][p].record(sim);
+                    }
+                });
+            }
+        }
+        pool.wait();
+
+        std::vector<EnsembleSummary> results = partial[0];
+        for (size_t w = 1; w < partial.size(); w++) {
+            for (size_t p = 0; p < grid.size(); p++) results[p].merge(partial[w][p]);
+        }
+        return results;
+    }
+};
+
+#endif //RPS_SIMULATOR_H